@@ -29,6 +29,8 @@ THE SOFTWARE.
 
 #ifdef ARDUINO
 #include "BERGCloudArduino.h"
+#elif defined(LINUX)
+#include "BERGCloudLinux.h"
 #else
 #error Please #include "BERGCloudMbed.h" or "BERGCloudLinux.h" instead.
 #endif
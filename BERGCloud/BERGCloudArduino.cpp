@@ -59,6 +59,11 @@ uint16_t BERGCloudArduino::SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uin
   return dataSize;
 }
 
+void BERGCloudArduino::SPIDeselect(void)
+{
+  digitalWrite(nSSELPin, HIGH);
+}
+
 void BERGCloudArduino::timerReset(void)
 {
   resetTime = millis();
@@ -69,13 +74,33 @@ uint32_t BERGCloudArduino::timerRead_mS(void)
   return millis() - resetTime;
 }
 
+uint32_t BERGCloudArduino::timerNow_uS(void)
+{
+  return micros();
+}
+
+void BERGCloudArduino::timerWait_uS(uint32_t time_uS)
+{
+  /* delayMicroseconds() is only accurate up to 16383uS */
+  if (time_uS >= 1000)
+  {
+    delay(time_uS / 1000);
+    time_uS %= 1000;
+  }
+
+  delayMicroseconds(time_uS);
+}
+
 void BERGCloudArduino::begin(SPIClass *_spi, uint8_t _nSSELPin)
 {
   /* Call base class method */
   BERGCloudBase::begin();
 
-  /* Configure nSSEL control pin */
+  /* Configure nSSEL control pin; set it high before enabling the */
+  /* output so this shield is not selected while others on the same */
+  /* bus are in use */
   nSSELPin = _nSSELPin;
+  digitalWrite(nSSELPin, HIGH);
   pinMode(nSSELPin, OUTPUT);
 
   /* Configure SPI */
@@ -125,20 +150,6 @@ uint16_t BERGCloudArduino::getHostType(void)
 
 #ifdef BERGCLOUD_PACK_UNPACK
 
-bool BERGCloudMessage::pack(double& n)
-{
-  /* For 16-bit Arduino platforms we can treat a double literal */
-  /* value as as float; this is so pack(1.234) will work. */
-
-  if (sizeof(double) == sizeof(float))
-  {
-     return pack((float)n);
-  }
-
-   _LOG("Pack: 8-byte double type is not supported.\r\n");
-  return false;
-}
-
 bool BERGCloudMessage::pack(String& s)
 {
   uint16_t strLen = s.length();
@@ -39,6 +39,8 @@ THE SOFTWARE.
 class BERGCloudArduino : public BERGCloudBase
 {
 public:
+  /* Several instances may share one SPIClass with different nSSEL pins; */
+  /* end() also ends the SPIClass, so only call it when all are finished */
   void begin(SPIClass *_spi, uint8_t _nSSELPin);
   void end();
   /* Methods using Arduino string class */
@@ -52,8 +54,11 @@ public:
 #endif
 private:
   uint16_t SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS);
+  void SPIDeselect(void);
   void timerReset(void);
   uint32_t timerRead_mS(void);
+  uint32_t timerNow_uS(void);
+  void timerWait_uS(uint32_t time_uS);
   uint16_t getHostType(void);
   uint8_t nSSELPin;
   SPIClass *spi;
@@ -67,8 +72,6 @@ class BERGCloudMessage : public BERGCloudMessageBase
 public:
   using BERGCloudMessageBase::pack;
   using BERGCloudMessageBase::unpack;
-  /* Pack a 4-byte double */
-  bool pack(double& n);
   /* Methods using Arduino string class */
   bool pack(String& s);
   bool unpack(String& s);
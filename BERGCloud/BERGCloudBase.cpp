@@ -29,52 +29,113 @@ THE SOFTWARE.
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h> /* For memset() */
+#include <stdio.h> /* For sscanf() */
+
+#ifdef __AVR__
+#include <avr/pgmspace.h> /* For memcpy_P() */
+#endif
+
+#ifdef BERGCLOUD_LOCK_PTHREAD
+#include <time.h>
+#endif
 
 #include "BERGCloudBase.h"
+#include "BERGCloudCRC16.h"
+#include "BERGCloudMessagePack.h"
 
 #define SPI_POLL_TIMEOUT_MS 1000
 #define SPI_SYNC_TIMEOUT_MS 10000
 
-#define CONNECT_POLL_RATE_MS 250
-
-/* MessagePack for named commands and events */
-#define _MP_FIXRAW_MIN      0xa0
-#define _MP_FIXRAW_MAX      0xbf
-#define _MAX_FIXRAW         (_MP_FIXRAW_MAX - _MP_FIXRAW_MIN)
+/* Phases of a non-blocking transaction */
+#define _BC_PHASE_SYNC      0
+#define _BC_PHASE_SEND      1
+#define _BC_PHASE_POLL      2
+#define _BC_PHASE_HEADER    3
+#define _BC_PHASE_DATA      4
+#define _BC_PHASE_FOOTER    5
+
+/* Bytes sent per SPITransaction() call by step() */
+#define _BC_STEP_CHUNK_SIZE 16
+
+#ifdef BERGCLOUD_STATS
+#define _BC_STATS(x) x
+#else
+#define _BC_STATS(x)
+#endif
 
 uint8_t BERGCloudBase::nullKey[BC_KEY_SIZE_BYTES] = {0};
 
+BERGCloudBase::BERGCloudBase(void)
+{
+  connectCallback = NULL;
+  /* Set here so that a policy set before begin() is kept */
+  setPollPolicy(NULL);
+#ifdef BERGCLOUD_STATS
+  memset(&stats, 0x00, sizeof(stats));
+#endif
+#ifdef BERGCLOUD_LOCK_PTHREAD
+  pthread_mutex_init(&lock, NULL);
+#endif
+#ifdef BERGCLOUD_LOCK_USER
+  lockContext = NULL;
+#endif
+#ifndef BERGCLOUD_LOCK_NONE
+  memset(&lockStats, 0x00, sizeof(lockStats));
+  lockTaken_uS = 0;
+#endif
+}
+
+BERGCloudBase::~BERGCloudBase(void)
+{
+#ifdef BERGCLOUD_LOCK_PTHREAD
+  pthread_mutex_destroy(&lock);
+#endif
+}
+
 bool BERGCloudBase::_transaction(_BC_SPI_TRANSACTION *tr)
 {
-  uint16_t i, j;
+  uint16_t i;
   uint8_t rxByte;
   bool timeout;
+  _BC_TIMER timer;
+  uint32_t gap;
   uint8_t dataSize;
   uint16_t groupSize;
   uint16_t dataCRC;
   uint16_t calcCRC;
   uint8_t header[SPI_HEADER_SIZE_BYTES];
   uint8_t footer[SPI_FOOTER_SIZE_BYTES];
+#ifdef BERGCLOUD_BULK_TRANSFER
+  uint8_t frame[SPI_MAX_PACKET_SIZE_BYTES];
+  uint16_t frameSize;
+  uint16_t totalSize;
+  BERGCloudSPISegment segment[BC_SPI_MAX_SEGMENTS];
+  uint8_t segments;
+#else
+  uint16_t j;
+#endif
 
   /* Check synchronisation */
   if (!synced)
   {
-    timerReset();
+    timerStart(&timer);
 
     do {
       rxByte = SPITransaction(SPI_PROTOCOL_PAD, true);
-      timeout = timerRead_mS() > SPI_SYNC_TIMEOUT_MS;
+      timeout = timerElapsed_mS(&timer) > SPI_SYNC_TIMEOUT_MS;
 
     } while ((rxByte != SPI_PROTOCOL_RESET) && !timeout);
 
     if (timeout)
     {
       _LOG("Timeout, sync (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.syncTimeouts++);
       return false;
     }
 
     /* Resynchronisation successful */
     synced = true;
+    _BC_STATS(stats.resyncs++);
   }
 
   /* Calculate total data size */
@@ -94,6 +155,85 @@ bool BERGCloudBase::_transaction(_BC_SPI_TRANSACTION *tr)
   header[2] = 0x00; /* Reserved */
   header[3] = dataSize;
 
+#ifdef BERGCLOUD_BULK_TRANSFER
+  /* Check the request fits in a single frame */
+  totalSize = 0;
+
+  for (i=0; i<_TX_GROUPS; i++)
+  {
+    totalSize += tr->tx[i].dataSize;
+  }
+
+  if (totalSize > SPI_MAX_PAYLOAD_SIZE_BYTES)
+  {
+    _LOG("SizeErr, send data (BERGCloudBase::transaction)\r\n");
+    return false;
+  }
+
+  /* Send the header, data groups and footer as segments of one */
+  /* transfer, straight from where they are; the echoed bytes are */
+  /* collected in the frame */
+  calcCRC = crc16(header, sizeof(header), calcCRC);
+
+  segment[0].dataOut = header;
+  segment[0].dataIn = frame;
+  segment[0].dataSize = sizeof(header);
+  segments = 1;
+  frameSize = sizeof(header);
+
+  for (i=0; i<_TX_GROUPS; i++)
+  {
+    if (tr->tx[i].dataSize > 0)
+    {
+      calcCRC = crc16(tr->tx[i].buffer, tr->tx[i].dataSize, calcCRC);
+
+      segment[segments].dataOut = tr->tx[i].buffer;
+      segment[segments].dataIn = &frame[frameSize];
+      segment[segments].dataSize = tr->tx[i].dataSize;
+      segments++;
+      frameSize += tr->tx[i].dataSize;
+    }
+  }
+
+  footer[0] = calcCRC >> 8;
+  footer[1] = calcCRC & 0xff;
+
+  segment[segments].dataOut = footer;
+  segment[segments].dataIn = &frame[frameSize];
+  segment[segments].dataSize = sizeof(footer);
+  segments++;
+  frameSize += sizeof(footer);
+
+  if (SPITransactionSegments(segment, segments, false) != frameSize)
+  {
+    /* The frame and footer hold no echoed bytes */
+    _LOG("SPIErr, send frame (BERGCloudBase::transaction)\r\n");
+    synced = false;
+    return false;
+  }
+
+  /* Check the echoed bytes */
+  for (i=0; i<frameSize; i++)
+  {
+    if (frame[i] == SPI_PROTOCOL_RESET)
+    {
+      /* The rest of the frame was clocked into a reset shield; */
+      /* resynchronise so that it discards them */
+      _LOG("Reset, send frame (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.resets++);
+      synced = false;
+      return false;
+    }
+
+    if (frame[i] != SPI_PROTOCOL_PAD)
+    {
+      _LOG("SyncErr, send frame (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.syncErrors++);
+      synced = false;
+      return false;
+    }
+  }
+#else
   /* Send header */
   for (i=0; i<sizeof(header); i++)
   {
@@ -104,12 +244,14 @@ bool BERGCloudBase::_transaction(_BC_SPI_TRANSACTION *tr)
     if (rxByte == SPI_PROTOCOL_RESET)
     {
       _LOG("Reset, send header (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.resets++);
       return false;
     }
 
     if (rxByte != SPI_PROTOCOL_PAD)
     {
       _LOG("SyncErr, send header (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.syncErrors++);
       synced = false;
       return false;
     }
@@ -126,12 +268,14 @@ bool BERGCloudBase::_transaction(_BC_SPI_TRANSACTION *tr)
       if (rxByte == SPI_PROTOCOL_RESET)
       {
         _LOG("Reset, send data (BERGCloudBase::transaction)\r\n");
+        _BC_STATS(stats.resets++);
         return false;
       }
 
       if (rxByte != SPI_PROTOCOL_PAD)
       {
         _LOG("SyncErr, send data (BERGCloudBase::transaction)\r\n");
+        _BC_STATS(stats.syncErrors++);
         synced = false;
         return false;
       }
@@ -150,51 +294,167 @@ bool BERGCloudBase::_transaction(_BC_SPI_TRANSACTION *tr)
     if (rxByte == SPI_PROTOCOL_RESET)
     {
       _LOG("Reset, send footer (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.resets++);
       return false;
     }
 
     if (rxByte != SPI_PROTOCOL_PAD)
     {
       _LOG("SyncErr, send footer (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.syncErrors++);
       synced = false;
       return false;
     }
   }
+#endif // #ifdef BERGCLOUD_BULK_TRANSFER
+
+  _BC_STATS(statsLatency(stats.requestLatency));
+  _BC_STATS(statsCurrent.bytesSent = SPI_HEADER_SIZE_BYTES + header[3] + SPI_FOOTER_SIZE_BYTES);
 
   /* Poll for response */
-  timerReset();
+  timerStart(&timer);
+  lastPollProbes = 0;
 
   do {
+    gap = pollGap_uS(lastPollProbes);
+
+    if (gap > 0)
+    {
+      /* Free the CPU between probes; nCS remains asserted and the */
+      /* lock is held, as the transaction is not finished */
+      if (pollPolicy.gapCallback != NULL)
+      {
+        pollPolicy.gapCallback(gap);
+      }
+      else
+      {
+        timerWait_uS(gap);
+      }
+    }
+
     rxByte = SPITransaction(SPI_PROTOCOL_PAD, false);
+    lastPollProbes++;
 
     if (rxByte == SPI_PROTOCOL_RESET)
     {
       _LOG("Reset, poll (BERGCloudBase::transaction)\r\n");
+      _BC_STATS(stats.resets++);
       return false;
     }
 
     if (rxByte == SPI_PROTOCOL_PENDING)
     {
       /* Waiting for data; reset timeout */
-      timerReset();
+      timerStart(&timer);
     }
 
-    timeout = timerRead_mS() > SPI_POLL_TIMEOUT_MS;
+    timeout = timerElapsed_mS(&timer) > SPI_POLL_TIMEOUT_MS;
 
   } while (((rxByte == SPI_PROTOCOL_PAD) || (rxByte == SPI_PROTOCOL_PENDING)) && !timeout);
 
   if (timeout)
   {
     _LOG("Timeout, poll (BERGCloudBase::transaction)\r\n");
+    _BC_STATS(stats.pollTimeouts++);
     synced = false;
     return false;
   }
 
+  _BC_STATS(statsLatency(stats.waitLatency));
+
   /* Initialise CRC */
   calcCRC = 0xffff;
 
   /* Read header, we already have the first byte */
   header[0] = rxByte;
+
+#ifdef BERGCLOUD_BULK_TRANSFER
+  memset(&header[1], SPI_PROTOCOL_PAD, SPI_HEADER_SIZE_BYTES - 1);
+
+  if (SPITransaction(&header[1], &header[1], SPI_HEADER_SIZE_BYTES - 1, false) != (SPI_HEADER_SIZE_BYTES - 1))
+  {
+    _LOG("SPIErr, read header (BERGCloudBase::transaction)\r\n");
+    synced = false;
+    return false;
+  }
+
+  calcCRC = crc16(header, SPI_HEADER_SIZE_BYTES, calcCRC);
+
+  /* Get data size */
+  dataSize = header[3];
+
+  /* Check the data will fit in the receive groups */
+  totalSize = 0;
+
+  for (i=0; i<_RX_GROUPS; i++)
+  {
+    totalSize += tr->rx[i].bufferSize;
+  }
+
+  if ((dataSize > totalSize) || (dataSize > SPI_MAX_PAYLOAD_SIZE_BYTES))
+  {
+    /* Too much data sent */
+    _LOG("SizeErr, read data (BERGCloudBase::transaction)\r\n");
+    synced = false;
+    return false;
+  }
+
+  /* Read the data straight into the receive groups, then the CRC, */
+  /* as segments of one transfer; the frame holds the pad bytes sent */
+  memset(frame, SPI_PROTOCOL_PAD, dataSize + SPI_FOOTER_SIZE_BYTES);
+  segments = 0;
+
+  for (i=0; i<_RX_GROUPS; i++)
+  {
+    groupSize = tr->rx[i].bufferSize;
+
+    if (groupSize > dataSize)
+    {
+      groupSize = dataSize;
+    }
+
+    if (groupSize > 0)
+    {
+      segment[segments].dataOut = frame;
+      segment[segments].dataIn = tr->rx[i].buffer;
+      segment[segments].dataSize = groupSize;
+      segments++;
+    }
+
+    if (tr->rx[i].dataSize != NULL)
+    {
+      /* Return the number of bytes used in this buffer */
+      *tr->rx[i].dataSize = groupSize;
+    }
+
+    /* Next */
+    dataSize -= groupSize;
+  }
+
+  segment[segments].dataOut = frame;
+  segment[segments].dataIn = footer;
+  segment[segments].dataSize = sizeof(footer);
+
+  /* Set nCS high at the end */
+  frameSize = header[3] + sizeof(footer);
+
+  if (SPITransactionSegments(segment, segments + 1, true) != frameSize)
+  {
+    /* The data and footer hold no received bytes */
+    _LOG("SPIErr, read data (BERGCloudBase::transaction)\r\n");
+    synced = false;
+    return false;
+  }
+
+  for (i=0; i<segments; i++)
+  {
+    calcCRC = crc16(segment[i].dataIn, segment[i].dataSize, calcCRC);
+  }
+
+  dataCRC = footer[0]; /* MSByte */
+  dataCRC <<= 8;
+  dataCRC |= footer[1]; /* LSByte */
+#else
   calcCRC = Crc16(header[0], calcCRC);
 
   for (i=1; i < SPI_HEADER_SIZE_BYTES; i++)
@@ -244,18 +504,25 @@ bool BERGCloudBase::_transaction(_BC_SPI_TRANSACTION *tr)
   dataCRC = SPITransaction(SPI_PROTOCOL_PAD, false); /* MSByte */
   dataCRC <<= 8;
   dataCRC |= SPITransaction(SPI_PROTOCOL_PAD, true /* nCS -> high */); /* LSByte */
+#endif // #ifdef BERGCLOUD_BULK_TRANSFER
+
+  _BC_STATS(statsLatency(stats.responseLatency));
+  _BC_STATS(statsCurrent.bytesReceived = SPI_HEADER_SIZE_BYTES + header[3] + SPI_FOOTER_SIZE_BYTES);
 
   /* Compare with calculated CRC */
   if (calcCRC != dataCRC)
   {
     /* Invalid CRC */
     _LOG("CRCErr, read data (BERGCloudBase::transaction)\r\n");
+    _BC_STATS(stats.crcErrors++);
     synced = false;
     return false;
   }
 
   /* Get reponse code */
   lastResponse = header[0];
+  lastStatus = BC_TRANSACTION_DONE;
+  _BC_STATS(stats.response[(lastResponse < (BC_STATS_RESPONSES - 1)) ? lastResponse : (BC_STATS_RESPONSES - 1)]++);
 
   return (lastResponse == SPI_RSP_SUCCESS);
 }
@@ -266,7 +533,31 @@ bool BERGCloudBase::transaction(_BC_SPI_TRANSACTION *tr)
 
   /* For thread synchronisation */
   lockTake();
+
+#ifdef BERGCLOUD_ASYNC
+  if (async.status == BC_TRANSACTION_IN_PROGRESS)
+  {
+    /* Can't interrupt a transaction started with begin...() */
+    _LOG("Busy (BERGCloudBase::transaction)\r\n");
+    lastStatus = BC_TRANSACTION_BUSY;
+    lockRelease();
+    return false;
+  }
+#endif
+
+  /* Set to BC_TRANSACTION_DONE when a response is read */
+  lastStatus = BC_TRANSACTION_FAILED;
+
+  _BC_STATS(statsBegin(tr->command));
   result = _transaction(tr);
+  _BC_STATS(statsEnd());
+
+  if (!result)
+  {
+    /* nCS may still be low if the transaction ended early */
+    SPIDeselect();
+  }
+
   lockRelease();
 
   return result;
@@ -277,161 +568,758 @@ void BERGCloudBase::initTransaction(_BC_SPI_TRANSACTION *tr)
   memset(tr, 0x00, sizeof(_BC_SPI_TRANSACTION));
 }
 
-bool BERGCloudBase::pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, uint8_t& commandID)
+#ifdef BERGCLOUD_ASYNC
+bool BERGCloudBase::beginTransaction(void)
 {
-  /* Returns TRUE if a valid command has been received */
-
-  _LOG("pollForCommand() methods returning a command ID number have been deprecated.\r\n");
-
-  _BC_SPI_TRANSACTION tr;
-  uint8_t cmdID[2] = {0};
-  uint16_t cmdIDSize = 0;
-
-  initTransaction(&tr);
+  /* Start the transaction set up in 'async' */
 
-  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+  if (async.status == BC_TRANSACTION_IN_PROGRESS)
+  {
+    _LOG("Busy (BERGCloudBase::beginTransaction)\r\n");
+    return false;
+  }
 
-  tr.rx[0].buffer = cmdID;
-  tr.rx[0].bufferSize = sizeof(cmdID);
-  tr.rx[0].dataSize = &cmdIDSize;
+  async.segment = 0;
+  async.offset = 0;
+  async.calcCRC = 0xffff;
+  async.dataCRC = 0;
 
-  tr.rx[1].buffer = commandBuffer;
-  tr.rx[1].bufferSize = commandBufferSize;
-  tr.rx[1].dataSize = &commandSize;
+  /* Create header */
+  async.header[0] = async.tr.command;
+  async.header[1] = 0x00; /* Reserved */
+  async.header[2] = 0x00; /* Reserved */
+  async.header[3] = 0;
 
-  if (transaction(&tr))
+  for (uint8_t i=0; i<_TX_GROUPS; i++)
   {
-    commandID = cmdID[1];
-    return true;
+    async.header[3] += async.tr.tx[i].dataSize;
   }
 
-  commandID = 0;
-  commandSize = 0;
-  return false;
+  async.phase = synced ? _BC_PHASE_SEND : _BC_PHASE_SYNC;
+  lastStatus = BC_TRANSACTION_FAILED;
+  async.response = SPI_RSP_SUCCESS;
+  async.status = BC_TRANSACTION_IN_PROGRESS;
+  _BC_STATS(statsBegin(async.tr.command));
+  timerStart(&async.timer);
+  return true;
 }
 
-bool BERGCloudBase::pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize)
+bool BERGCloudBase::beginSendEvent(const char *eventName, uint8_t *eventBuffer, uint16_t eventSize, bool packed)
 {
-  /* Returns TRUE if a valid command has been received */
+  /* Returns TRUE if the transaction has started */
 
-  _BC_SPI_TRANSACTION tr;
-  uint8_t cmdID[2] = {0};
-  uint16_t cmdIDSize = 0;
-  uint8_t commandNameSize;
-  uint8_t originalCommandNameSize;
-  uint8_t msgPackByte;
-  uint16_t command;
+  uint8_t headerSize;
+  bool result;
 
-  if ((commandName == NULL) || (commandNameMaxSize < 2))
+  if (!packed)
   {
+    /* We only support packed data now */
     return false;
   }
 
-  initTransaction(&tr);
+  lockTake();
 
-  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+  if (async.status == BC_TRANSACTION_IN_PROGRESS)
+  {
+    _LOG("Busy (BERGCloudBase::beginSendEvent)\r\n");
+    lockRelease();
+    return false;
+  }
 
-  tr.rx[0].buffer = cmdID;
-  tr.rx[0].bufferSize = sizeof(cmdID);
-  tr.rx[0].dataSize = &cmdIDSize;
+  initTransaction(&async.tr);
+  /* Copy the name, as it may not outlive the transaction */
+  headerSize = createEventHeader(async.eventHeader, eventName);
 
-  tr.rx[1].buffer = commandBuffer;
-  tr.rx[1].bufferSize = commandBufferSize;
-  tr.rx[1].dataSize = &commandSize;
+  if (headerSize == 0)
+  {
+    lockRelease();
+    return false;
+  }
 
-  if (transaction(&tr))
+  if (eventSize > ((uint16_t)SPI_MAX_PAYLOAD_SIZE_BYTES - headerSize))
   {
-    command = (cmdID[0] << 8) | cmdID[1];
-    if (command == BC_COMMAND_NAMED_PACKED)
-    {
-      /* Get command name string size */
-      msgPackByte = *commandBuffer;
+    _LOG("Event is too big.\r\n");
+    lockRelease();
+    return false;
+  }
 
-      if ((msgPackByte <_MP_FIXRAW_MIN) || (msgPackByte > _MP_FIXRAW_MAX))
-      {
-        /* Invalid */
-        return false;
-      }
+  async.tr.command = SPI_CMD_SEND_EVENT_PACKED;
+  async.tr.tx[0].buffer = async.eventHeader;
+  async.tr.tx[0].dataSize = headerSize;
+  async.tr.tx[1].buffer = eventBuffer;
+  async.tr.tx[1].dataSize = eventSize;
 
-      commandNameSize = originalCommandNameSize = msgPackByte - _MP_FIXRAW_MIN;
+  result = beginTransaction();
+  lockRelease();
 
-      /* Limit to the size of the buffer provided */
-      if (commandNameSize > (commandNameMaxSize-1)) /* -1 for null terminator */
-      {
-        commandNameSize = (commandNameMaxSize-1);
-      }
+  return result;
+}
 
-      /* Copy command name string as a null-terminated C string */
-      bytecpy((uint8_t *)commandName, (commandBuffer+1), commandNameSize); /* +1 for messagePack fixraw byte */
-      commandName[commandNameSize] = '\0';
+bool BERGCloudBase::beginPollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize)
+{
+  /* Returns TRUE if the transaction has started */
 
-      /* Move up remaining packed data, update size */
-      commandSize -= (originalCommandNameSize + 1); /* +1 for messagePack fixraw byte */
-      bytecpy(commandBuffer, commandBuffer + (originalCommandNameSize + 1), commandSize);
-      return true;
-    }
+  bool result;
+
+  if ((commandName == NULL) || (commandNameMaxSize < 2))
+  {
+    return false;
   }
 
-  *commandName = '\0';
-  commandSize = 0;
-  return false;
+  lockTake();
+
+  if (async.status == BC_TRANSACTION_IN_PROGRESS)
+  {
+    _LOG("Busy (BERGCloudBase::beginPollForCommand)\r\n");
+    lockRelease();
+    return false;
+  }
+
+  initPollForCommand(commandBuffer, commandBufferSize, &commandSize, commandName, commandNameMaxSize);
+
+  result = beginTransaction();
+  lockRelease();
+
+  return result;
 }
 
-#ifdef BERGCLOUD_PACK_UNPACK
-bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, uint8_t& commandID)
+void BERGCloudBase::initPollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t *commandSize, char *commandName, uint8_t commandNameMaxSize)
 {
-  /* Returns TRUE if a valid command has been received */
+  /* Set up 'async' for SPI_CMD_POLL_FOR_COMMAND; the lock must be held */
 
-  _LOG("pollForCommand() methods returning a command ID number have been deprecated.\r\n");
+  initTransaction(&async.tr);
 
-  _BC_SPI_TRANSACTION tr;
-  uint8_t cmdID[2] = {0};
-  uint16_t cmdIDSize = 0;
-  uint16_t dataSize = 0;
+  async.cmdID[0] = 0;
+  async.cmdID[1] = 0;
+  async.commandSize = 0;
+  async.commandSizeOut = commandSize;
+  async.commandName = commandName;
+  async.commandNameMaxSize = commandNameMaxSize;
+#ifdef BERGCLOUD_PACK_UNPACK
+  async.buffer = NULL;
+#endif
 
-  initTransaction(&tr);
-  buffer.clear();
+  async.tr.command = SPI_CMD_POLL_FOR_COMMAND;
 
-  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+  async.tr.rx[0].buffer = async.cmdID;
+  async.tr.rx[0].bufferSize = sizeof(async.cmdID);
 
-  tr.rx[0].buffer = cmdID;
-  tr.rx[0].bufferSize = sizeof(cmdID);
-  tr.rx[0].dataSize = &cmdIDSize;
+  async.tr.rx[1].buffer = commandBuffer;
+  async.tr.rx[1].bufferSize = commandBufferSize;
+  async.tr.rx[1].dataSize = &async.commandSize;
+}
 
-  tr.rx[1].buffer = buffer.ptr();
-  tr.rx[1].bufferSize = buffer.size();
-  tr.rx[1].dataSize = &dataSize;
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudBase::beginSendEvent(const char *eventName, BERGCloudMessageBuffer& buffer)
+{
+  /* Returns TRUE if the transaction has started */
 
-  if (transaction(&tr))
+  uint8_t *event;
+  uint16_t eventSize;
+  bool result;
+
+  lockTake();
+
+  if (async.status == BC_TRANSACTION_IN_PROGRESS)
   {
-    commandID = cmdID[1];
-    buffer.used(dataSize);
-    return true;
+    _LOG("Busy (BERGCloudBase::beginSendEvent)\r\n");
+    lockRelease();
+    return false;
   }
 
-  commandID = 0;
-  buffer.used(0);
-  return false;
-}
+  event = createEventHeader(buffer, eventName, eventSize);
 
-bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize)
+  if (event == NULL)
+  {
+    /* Not enough headroom; copy the name instead */
+    lockRelease();
+    return beginSendEvent(eventName, buffer.ptr(), buffer.used());
+  }
+
+  if (eventSize > SPI_MAX_PAYLOAD_SIZE_BYTES)
+  {
+    _LOG("Event is too big.\r\n");
+    lockRelease();
+    return false;
+  }
+
+  initTransaction(&async.tr);
+
+  async.tr.command = SPI_CMD_SEND_EVENT_PACKED;
+  async.tr.tx[0].buffer = event;
+  async.tr.tx[0].dataSize = eventSize;
+
+  result = beginTransaction();
+  lockRelease();
+
+  return result;
+}
+
+bool BERGCloudBase::beginPollForCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize)
+{
+  /* Returns TRUE if the transaction has started */
+
+  bool result;
+
+  if ((commandName == NULL) || (commandNameMaxSize < 2))
+  {
+    return false;
+  }
+
+  lockTake();
+
+  if (async.status == BC_TRANSACTION_IN_PROGRESS)
+  {
+    /* The buffer may be in use by this transaction */
+    _LOG("Busy (BERGCloudBase::beginPollForCommand)\r\n");
+    lockRelease();
+    return false;
+  }
+
+  buffer.clear();
+  initPollForCommand(buffer.ptr(), buffer.size(), NULL, commandName, commandNameMaxSize);
+
+  /* Update the buffer when complete */
+  async.buffer = &buffer;
+
+  result = beginTransaction();
+  lockRelease();
+
+  return result;
+}
+#endif
+
+uint8_t BERGCloudBase::step(uint16_t maxBytes)
+{
+  uint8_t status;
+
+  /* For thread synchronisation */
+  lockTake();
+  status = _step(maxBytes);
+  lockRelease();
+
+  return status;
+}
+
+uint8_t BERGCloudBase::stepStatus(void)
+{
+  return async.status;
+}
+
+uint8_t BERGCloudBase::stepResponse(void)
+{
+  uint8_t response;
+
+  lockTake();
+  response = async.response;
+  lockRelease();
+
+  return response;
+}
+
+bool BERGCloudBase::stepSegment(uint8_t **buffer, uint16_t *size)
+{
+  /* Get the rest of the header, data group or footer being sent; */
+  /* returns FALSE once everything has been sent */
+
+  uint8_t *segmentBuffer;
+  uint16_t segmentSize;
+
+  for (;;)
+  {
+    if (async.segment == 0)
+    {
+      segmentBuffer = async.header;
+      segmentSize = sizeof(async.header);
+    }
+    else if (async.segment <= _TX_GROUPS)
+    {
+      segmentBuffer = async.tr.tx[async.segment - 1].buffer;
+      segmentSize = async.tr.tx[async.segment - 1].dataSize;
+    }
+    else if (async.segment == (_TX_GROUPS + 1))
+    {
+      /* Create footer */
+      async.footer[0] = async.calcCRC >> 8;
+      async.footer[1] = async.calcCRC & 0xff;
+      segmentBuffer = async.footer;
+      segmentSize = sizeof(async.footer);
+    }
+    else
+    {
+      return false;
+    }
+
+    if (async.offset < segmentSize)
+    {
+      *buffer = segmentBuffer + async.offset;
+      *size = segmentSize - async.offset;
+      return true;
+    }
+
+    /* Next */
+    async.segment++;
+    async.offset = 0;
+  }
+}
+
+uint8_t BERGCloudBase::_step(uint16_t maxBytes)
+{
+  uint8_t chunk[_BC_STEP_CHUNK_SIZE];
+  uint8_t *buffer;
+  uint16_t size;
+  uint16_t i;
+  uint8_t rxByte;
+  uint32_t gap;
+  _BC_RX_GROUP *group;
+
+  while ((async.status == BC_TRANSACTION_IN_PROGRESS) && (maxBytes > 0))
+  {
+    switch (async.phase)
+    {
+      case _BC_PHASE_SYNC:
+        rxByte = SPITransaction(SPI_PROTOCOL_PAD, true);
+        maxBytes--;
+
+        if (rxByte == SPI_PROTOCOL_RESET)
+        {
+          /* Resynchronisation successful */
+          synced = true;
+          _BC_STATS(stats.resyncs++);
+          async.phase = _BC_PHASE_SEND;
+        }
+        else if (timerElapsed_mS(&async.timer) > SPI_SYNC_TIMEOUT_MS)
+        {
+          _LOG("Timeout, sync (BERGCloudBase::step)\r\n");
+          _BC_STATS(stats.syncTimeouts++);
+          stepComplete(false);
+        }
+        break;
+
+      case _BC_PHASE_SEND:
+        if (!stepSegment(&buffer, &size))
+        {
+          /* Request sent; poll for response */
+          _BC_STATS(statsLatency(stats.requestLatency));
+          _BC_STATS(statsCurrent.bytesSent = SPI_HEADER_SIZE_BYTES + async.header[3] + SPI_FOOTER_SIZE_BYTES);
+          async.phase = _BC_PHASE_POLL;
+          timerStart(&async.timer);
+          timerStart_uS(&async.gapTimer);
+          lastPollProbes = 0;
+          break;
+        }
+
+        if (size > maxBytes)
+        {
+          size = maxBytes;
+        }
+
+        if (size > sizeof(chunk))
+        {
+          size = sizeof(chunk);
+        }
+
+        memcpy(chunk, buffer, size);
+
+        if (async.segment <= _TX_GROUPS)
+        {
+          /* Header and data are included in the CRC, the footer is not */
+          async.calcCRC = crc16(chunk, size, async.calcCRC);
+        }
+
+        SPITransaction(chunk, chunk, size, false);
+        maxBytes -= size;
+        async.offset += size;
+
+        /* Check the echoed bytes */
+        for (i=0; i<size; i++)
+        {
+          if (chunk[i] == SPI_PROTOCOL_RESET)
+          {
+            /* As for the bulk path, resynchronise so that the shield */
+            /* discards anything clocked in after the reset */
+            _LOG("Reset, send (BERGCloudBase::step)\r\n");
+            _BC_STATS(stats.resets++);
+            synced = false;
+            stepComplete(false);
+            break;
+          }
+
+          if (chunk[i] != SPI_PROTOCOL_PAD)
+          {
+            _LOG("SyncErr, send (BERGCloudBase::step)\r\n");
+            _BC_STATS(stats.syncErrors++);
+            synced = false;
+            stepComplete(false);
+            break;
+          }
+        }
+        break;
+
+      case _BC_PHASE_POLL:
+        gap = pollGap_uS(lastPollProbes);
+
+        if ((gap > 0) && (timerElapsed_uS(&async.gapTimer) < gap))
+        {
+          /* Leave the bus idle until the gap has passed */
+          return async.status;
+        }
+
+        rxByte = SPITransaction(SPI_PROTOCOL_PAD, false);
+        timerStart_uS(&async.gapTimer);
+        lastPollProbes++;
+        maxBytes--;
+
+        if (rxByte == SPI_PROTOCOL_RESET)
+        {
+          _LOG("Reset, poll (BERGCloudBase::step)\r\n");
+          _BC_STATS(stats.resets++);
+          stepComplete(false);
+          break;
+        }
+
+        if (rxByte == SPI_PROTOCOL_PENDING)
+        {
+          /* Waiting for data; reset timeout */
+          timerStart(&async.timer);
+        }
+        else if (rxByte != SPI_PROTOCOL_PAD)
+        {
+          /* Start of the response header */
+          _BC_STATS(statsLatency(stats.waitLatency));
+          async.header[0] = rxByte;
+          async.offset = 1;
+          async.phase = _BC_PHASE_HEADER;
+          break;
+        }
+
+        if (timerElapsed_mS(&async.timer) > SPI_POLL_TIMEOUT_MS)
+        {
+          _LOG("Timeout, poll (BERGCloudBase::step)\r\n");
+          _BC_STATS(stats.pollTimeouts++);
+          synced = false;
+          stepComplete(false);
+        }
+        break;
+
+      case _BC_PHASE_HEADER:
+        size = SPI_HEADER_SIZE_BYTES - async.offset;
+
+        if (size > maxBytes)
+        {
+          size = maxBytes;
+        }
+
+        buffer = &async.header[async.offset];
+        memset(buffer, SPI_PROTOCOL_PAD, size);
+        SPITransaction(buffer, buffer, size, false);
+        maxBytes -= size;
+        async.offset += size;
+
+        if (async.offset < SPI_HEADER_SIZE_BYTES)
+        {
+          break;
+        }
+
+        async.calcCRC = crc16(async.header, SPI_HEADER_SIZE_BYTES, 0xffff);
+        async.dataSize = async.header[3];
+
+        /* Check the data will fit in the receive groups */
+        size = 0;
+
+        for (i=0; i<_RX_GROUPS; i++)
+        {
+          size += async.tr.rx[i].bufferSize;
+
+          if (async.tr.rx[i].dataSize != NULL)
+          {
+            *async.tr.rx[i].dataSize = 0;
+          }
+        }
+
+        if (async.dataSize > size)
+        {
+          /* Too much data sent */
+          _LOG("SizeErr, read data (BERGCloudBase::step)\r\n");
+          synced = false;
+          stepComplete(false);
+          break;
+        }
+
+        async.segment = 0;
+        async.offset = 0;
+        async.phase = _BC_PHASE_DATA;
+        break;
+
+      case _BC_PHASE_DATA:
+        if (async.dataSize == 0)
+        {
+          async.offset = 0;
+          async.phase = _BC_PHASE_FOOTER;
+          break;
+        }
+
+        /* Find the next group with space */
+        group = &async.tr.rx[async.segment];
+
+        if (async.offset >= group->bufferSize)
+        {
+          async.segment++;
+          async.offset = 0;
+          break;
+        }
+
+        size = group->bufferSize - async.offset;
+
+        if (size > async.dataSize)
+        {
+          size = async.dataSize;
+        }
+
+        if (size > maxBytes)
+        {
+          size = maxBytes;
+        }
+
+        buffer = group->buffer + async.offset;
+        memset(buffer, SPI_PROTOCOL_PAD, size);
+        SPITransaction(buffer, buffer, size, false);
+        async.calcCRC = crc16(buffer, size, async.calcCRC);
+        maxBytes -= size;
+        async.offset += size;
+        async.dataSize -= size;
+
+        if (group->dataSize != NULL)
+        {
+          /* Return the number of bytes used in this buffer */
+          *group->dataSize += size;
+        }
+        break;
+
+      case _BC_PHASE_FOOTER:
+        /* Read CRC; set nCS high after the last byte */
+        rxByte = SPITransaction(SPI_PROTOCOL_PAD, async.offset == (SPI_FOOTER_SIZE_BYTES - 1));
+        maxBytes--;
+        async.dataCRC = (async.dataCRC << 8) | rxByte;
+        async.offset++;
+
+        if (async.offset < SPI_FOOTER_SIZE_BYTES)
+        {
+          break;
+        }
+
+        _BC_STATS(statsLatency(stats.responseLatency));
+        _BC_STATS(statsCurrent.bytesReceived = SPI_HEADER_SIZE_BYTES + async.header[3] + SPI_FOOTER_SIZE_BYTES);
+
+        /* Compare with calculated CRC */
+        if (async.calcCRC != async.dataCRC)
+        {
+          /* Invalid CRC */
+          _LOG("CRCErr, read data (BERGCloudBase::step)\r\n");
+          _BC_STATS(stats.crcErrors++);
+          synced = false;
+          stepComplete(false);
+          break;
+        }
+
+        /* Get reponse code */
+        lastResponse = async.header[0];
+        lastStatus = BC_TRANSACTION_DONE;
+        async.response = lastResponse;
+        _BC_STATS(stats.response[(lastResponse < (BC_STATS_RESPONSES - 1)) ? lastResponse : (BC_STATS_RESPONSES - 1)]++);
+        stepComplete(lastResponse == SPI_RSP_SUCCESS);
+        break;
+
+      default:
+        stepComplete(false);
+        break;
+    }
+  }
+
+  return async.status;
+}
+
+void BERGCloudBase::stepComplete(bool success)
+{
+  uint16_t commandSize = async.commandSize;
+  uint8_t *commandBuffer = async.tr.rx[1].buffer;
+  uint8_t commandNameSize;
+  uint8_t dataOffset = 0;
+
+  if (!success)
+  {
+    /* nCS may still be low if the transaction ended early */
+    SPIDeselect();
+  }
+
+  if ((async.tr.command == SPI_CMD_POLL_FOR_COMMAND) && (async.commandName != NULL))
+  {
+    if (success)
+    {
+      success = findCommandName(async.cmdID, commandBuffer, commandSize, commandNameSize);
+    }
+
+    if (!success)
+    {
+      *async.commandName = '\0';
+      commandSize = 0;
+    }
+    else
+    {
+      copyCommandName(commandBuffer + 1, commandNameSize, async.commandName, async.commandNameMaxSize); /* +1 for messagePack fixraw byte */
+      dataOffset = commandNameSize + 1;
+    }
+
+#ifdef BERGCLOUD_PACK_UNPACK
+    if (async.buffer != NULL)
+    {
+      /* The data is left where it is, after the name */
+      async.buffer->used(commandSize);
+      async.buffer->trim(dataOffset);
+    }
+#endif
+
+    if (async.commandSizeOut != NULL)
+    {
+      /* Move up the data to the start of the buffer */
+      commandSize -= dataOffset;
+      bytecpy(commandBuffer, commandBuffer + dataOffset, commandSize);
+      *async.commandSizeOut = commandSize;
+    }
+  }
+
+  async.status = success ? BC_TRANSACTION_DONE : BC_TRANSACTION_FAILED;
+  _BC_STATS(statsEnd());
+}
+#endif // #ifdef BERGCLOUD_ASYNC
+
+bool BERGCloudBase::pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, uint8_t& commandID)
+{
+  /* Returns TRUE if a valid command has been received */
+
+  _LOG("pollForCommand() methods returning a command ID number have been deprecated.\r\n");
+
+  _BC_SPI_TRANSACTION tr;
+  uint8_t cmdID[2] = {0};
+  uint16_t cmdIDSize = 0;
+
+  initTransaction(&tr);
+
+  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+
+  tr.rx[0].buffer = cmdID;
+  tr.rx[0].bufferSize = sizeof(cmdID);
+  tr.rx[0].dataSize = &cmdIDSize;
+
+  tr.rx[1].buffer = commandBuffer;
+  tr.rx[1].bufferSize = commandBufferSize;
+  tr.rx[1].dataSize = &commandSize;
+
+  if (transaction(&tr))
+  {
+    commandID = cmdID[1];
+    return true;
+  }
+
+  commandID = 0;
+  commandSize = 0;
+  return false;
+}
+
+bool BERGCloudBase::pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize)
 {
   /* Returns TRUE if a valid command has been received */
 
   _BC_SPI_TRANSACTION tr;
   uint8_t cmdID[2] = {0};
   uint16_t cmdIDSize = 0;
-  uint16_t dataSize = 0;
-  uint8_t commandNameSize;
-  uint8_t originalCommandNameSize;
-  uint8_t msgPackByte;
-  uint16_t command;
 
   if ((commandName == NULL) || (commandNameMaxSize < 2))
   {
     return false;
   }
 
+  initTransaction(&tr);
+
+  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+
+  tr.rx[0].buffer = cmdID;
+  tr.rx[0].bufferSize = sizeof(cmdID);
+  tr.rx[0].dataSize = &cmdIDSize;
+
+  tr.rx[1].buffer = commandBuffer;
+  tr.rx[1].bufferSize = commandBufferSize;
+  tr.rx[1].dataSize = &commandSize;
+
+  if (transaction(&tr))
+  {
+    if (getCommandName(cmdID, commandBuffer, commandSize, commandName, commandNameMaxSize))
+    {
+      return true;
+    }
+  }
+
+  *commandName = '\0';
+  commandSize = 0;
+  return false;
+}
+
+bool BERGCloudBase::pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, const char *&commandName, uint8_t& commandNameSize)
+{
+  /* Returns TRUE if a command has been received, with or without a */
+  /* name; the name is left in front of the data rather than copied */
+
+  _BC_SPI_TRANSACTION tr;
+  uint8_t cmdID[2] = {0};
+  uint16_t cmdIDSize = 0;
+
+  initTransaction(&tr);
+
+  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+
+  tr.rx[0].buffer = cmdID;
+  tr.rx[0].bufferSize = sizeof(cmdID);
+  tr.rx[0].dataSize = &cmdIDSize;
+
+  tr.rx[1].buffer = commandBuffer;
+  tr.rx[1].bufferSize = commandBufferSize;
+  tr.rx[1].dataSize = &commandSize;
+
+  commandName = (const char *)commandBuffer;
+  commandNameSize = 0;
+
+  if (!transaction(&tr))
+  {
+    commandSize = 0;
+    return false;
+  }
+
+  if (findCommandName(cmdID, commandBuffer, commandSize, commandNameSize))
+  {
+    commandName = (const char *)commandBuffer + 1; /* +1 for messagePack fixraw byte */
+    commandSize -= (commandNameSize + 1);
+  }
+  else
+  {
+    /* Not a named command; all of it is data */
+    commandNameSize = 0;
+  }
+
+  return true;
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, uint8_t& commandID)
+{
+  /* Returns TRUE if a valid command has been received */
+
+  _LOG("pollForCommand() methods returning a command ID number have been deprecated.\r\n");
+
+  _BC_SPI_TRANSACTION tr;
+  uint8_t cmdID[2] = {0};
+  uint16_t cmdIDSize = 0;
+  uint16_t dataSize = 0;
+
   initTransaction(&tr);
   buffer.clear();
 
@@ -447,41 +1335,75 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
 
   if (transaction(&tr))
   {
-    command = (cmdID[0] << 8) | cmdID[1];
-    if (command == BC_COMMAND_NAMED_PACKED)
-    {
-      /* Get command name string size */
-      msgPackByte = *buffer.ptr();
+    commandID = cmdID[1];
+    buffer.used(dataSize);
+    return true;
+  }
 
-      if ((msgPackByte <_MP_FIXRAW_MIN) || (msgPackByte > _MP_FIXRAW_MAX))
-      {
-        /* Invalid */
-        return false;
-      }
+  commandID = 0;
+  buffer.used(0);
+  return false;
+}
+
+bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize)
+{
+  /* Returns TRUE if a valid command has been received */
 
-      commandNameSize = originalCommandNameSize = msgPackByte - _MP_FIXRAW_MIN;
+  const char *name;
+  uint8_t nameSize;
 
-      /* Limit to the size of the buffer provided */
-      if (commandNameSize > (commandNameMaxSize-1)) /* -1 for null terminator */
-      {
-        commandNameSize = (commandNameMaxSize-1);
-      }
+  if ((commandName == NULL) || (commandNameMaxSize < 2))
+  {
+    return false;
+  }
+
+  if (pollForCommand(buffer, name, nameSize))
+  {
+    copyCommandName((const uint8_t *)name, nameSize, commandName, commandNameMaxSize);
+    return true;
+  }
+
+  *commandName = '\0';
+  return false;
+}
+
+bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, const char *&commandName, uint8_t& commandNameSize)
+{
+  /* Returns TRUE if a valid command has been received; the name is */
+  /* left in the buffer in front of the data rather than copied */
+
+  _BC_SPI_TRANSACTION tr;
+  uint8_t cmdID[2] = {0};
+  uint16_t cmdIDSize = 0;
+  uint16_t dataSize = 0;
 
-      /* Copy command name string as a null-terminated C string */
-      bytecpy((uint8_t *)commandName, (buffer.ptr()+1), commandNameSize); /* +1 for messagePack fixraw byte */
-      commandName[commandNameSize] = '\0';
+  initTransaction(&tr);
+  buffer.clear();
+
+  tr.command = SPI_CMD_POLL_FOR_COMMAND;
+
+  tr.rx[0].buffer = cmdID;
+  tr.rx[0].bufferSize = sizeof(cmdID);
+  tr.rx[0].dataSize = &cmdIDSize;
 
-      /* Move up remaining packed data, update size */
-      dataSize -= (originalCommandNameSize + 1); /* +1 for messagePack fixraw byte */
-      bytecpy(buffer.ptr(), buffer.ptr() + (originalCommandNameSize + 1), dataSize);
+  tr.rx[1].buffer = buffer.ptr();
+  tr.rx[1].bufferSize = buffer.size();
+  tr.rx[1].dataSize = &dataSize;
 
+  if (transaction(&tr))
+  {
+    if (findCommandName(cmdID, buffer.ptr(), dataSize, commandNameSize))
+    {
+      commandName = (const char *)buffer.ptr() + 1; /* +1 for messagePack fixraw byte */
       buffer.used(dataSize);
+      buffer.trim(commandNameSize + 1);
       return true;
     }
   }
 
   buffer.used(0);
-  *commandName = '\0';
+  commandName = "";
+  commandNameSize = 0;
   return false;
 }
 #endif
@@ -525,8 +1447,12 @@ bool BERGCloudBase::sendEvent(const char *eventName, uint8_t *eventBuffer, uint1
   /* Returns TRUE if the event is sent successfully */
 
   _BC_SPI_TRANSACTION tr;
-  uint8_t headerSize = 5; /* Four bytes of SPI header, one byte of messagePack type */
-  uint8_t header[5 + _MAX_FIXRAW] = {0}; /* Header size plus maximum name string size */
+  uint8_t headerSize;
+#if (_TX_GROUPS >= 3)
+  uint8_t header[SPI_EVENT_HEADER_SIZE_BYTES + 1] = {0}; /* +1 for messagePack fixraw byte */
+#else
+  uint8_t header[_BC_EVENT_HEADER_MAX_SIZE] = {0};
+#endif
 
   if (!packed)
   {
@@ -534,25 +1460,11 @@ bool BERGCloudBase::sendEvent(const char *eventName, uint8_t *eventBuffer, uint1
     return false;
   }
 
-  if ((eventName == NULL) || (eventName[0] == '\0'))
-  {
-    _LOG("Event name must be at least one character.\r\n");
-    return false;
-  }
+  headerSize = createEventHeader(header, eventName, (_TX_GROUPS < 3));
 
-  /* Create SPI header */
-  header[0] = BC_EVENT_NAMED_PACKED & BC_EVENT_ID_MASK;
-  header[1] = 0;
-  header[2] = 0;
-  header[3] = 0;
-
-  /* Create string header in messagePack format */
-  header[4] = _MP_FIXRAW_MIN;
-  while ((*eventName != '\0') && (headerSize < sizeof(header)))
+  if (headerSize == 0)
   {
-    /* Copy string, update messagePack byte */
-    header[4]++;
-    header[headerSize++] = *eventName++;
+    return false;
   }
 
   if (eventSize > ((uint16_t)SPI_MAX_PAYLOAD_SIZE_BYTES - headerSize))
@@ -564,10 +1476,20 @@ bool BERGCloudBase::sendEvent(const char *eventName, uint8_t *eventBuffer, uint1
   initTransaction(&tr);
 
   tr.command = SPI_CMD_SEND_EVENT_PACKED;
+#if (_TX_GROUPS >= 3)
+  /* Send the name from where it is */
+  tr.tx[0].buffer = (uint8_t *)header;
+  tr.tx[0].dataSize = sizeof(header);
+  tr.tx[1].buffer = (uint8_t *)eventName;
+  tr.tx[1].dataSize = headerSize - sizeof(header);
+  tr.tx[2].buffer = eventBuffer;
+  tr.tx[2].dataSize = eventSize;
+#else
   tr.tx[0].buffer = (uint8_t *)header;
   tr.tx[0].dataSize = headerSize;
   tr.tx[1].buffer = eventBuffer;
   tr.tx[1].dataSize = eventSize;
+#endif
 
   return transaction(&tr);
 }
@@ -587,48 +1509,246 @@ bool BERGCloudBase::sendEvent(const char *eventName, BERGCloudMessageBuffer& buf
 {
   /* Returns TRUE if the event is sent successfully */
 
-  _BC_SPI_TRANSACTION tr;
-  uint8_t headerSize = 5; /* Four bytes of SPI header, one byte of messagePack type */
-  uint8_t header[5 + _MAX_FIXRAW] = {0}; /* Header size plus maximum name string size */
+  _BC_SPI_TRANSACTION tr;
+  uint8_t *event;
+  uint16_t eventSize;
+
+  event = createEventHeader(buffer, eventName, eventSize);
+
+  if (event == NULL)
+  {
+    /* Not enough headroom; copy the name instead */
+    return sendEvent(eventName, buffer.ptr(), buffer.used());
+  }
+
+  if (eventSize > SPI_MAX_PAYLOAD_SIZE_BYTES)
+  {
+    _LOG("Event is too big.\r\n");
+    return false;
+  }
+
+  initTransaction(&tr);
+
+  tr.command = SPI_CMD_SEND_EVENT_PACKED;
+  tr.tx[0].buffer = event;
+  tr.tx[0].dataSize = eventSize;
+
+  return transaction(&tr);
+}
+#endif
+
+bool BERGCloudBase::sendEncodedEvent(const uint8_t *header, uint8_t headerSize, uint8_t *eventBuffer, uint16_t eventSize)
+{
+  /* Returns TRUE if the event is sent successfully; the header was */
+  /* created by BERGCloudEncodeEventName() */
+
+  _BC_SPI_TRANSACTION tr;
+#ifdef __AVR__
+  uint8_t flashHeader[_BC_EVENT_HEADER_MAX_SIZE];
+
+  /* Copy the header from flash */
+  memcpy_P(flashHeader, header, headerSize);
+  header = flashHeader;
+#endif
+
+  if (eventSize > ((uint16_t)SPI_MAX_PAYLOAD_SIZE_BYTES - headerSize))
+  {
+    _LOG("Event is too big.\r\n");
+    return false;
+  }
+
+  initTransaction(&tr);
+
+  tr.command = SPI_CMD_SEND_EVENT_PACKED;
+  tr.tx[0].buffer = (uint8_t *)header;
+  tr.tx[0].dataSize = headerSize;
+  tr.tx[1].buffer = eventBuffer;
+  tr.tx[1].dataSize = eventSize;
+
+  return transaction(&tr);
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudBase::sendEncodedEvent(const uint8_t *header, uint8_t headerSize, BERGCloudMessageBuffer& buffer)
+{
+  /* Returns TRUE if the event is sent successfully */
+
+#ifdef __AVR__
+  _BC_SPI_TRANSACTION tr;
+  uint8_t *event;
+  uint16_t eventSize;
+
+  if (buffer.headroom() >= headerSize)
+  {
+    /* Copy the header from flash straight into the headroom */
+    event = buffer.ptr() - headerSize;
+    memcpy_P(event, header, headerSize);
+    eventSize = headerSize + buffer.used();
+
+    if (eventSize > SPI_MAX_PAYLOAD_SIZE_BYTES)
+    {
+      _LOG("Event is too big.\r\n");
+      return false;
+    }
+
+    initTransaction(&tr);
+
+    tr.command = SPI_CMD_SEND_EVENT_PACKED;
+    tr.tx[0].buffer = event;
+    tr.tx[0].dataSize = eventSize;
+
+    return transaction(&tr);
+  }
+#endif
+
+  /* The header is sent from where it is */
+  return sendEncodedEvent(header, headerSize, buffer.ptr(), buffer.used());
+}
+#endif
+
+uint8_t BERGCloudBase::createEventHeader(uint8_t *header, const char *eventName, bool copyName)
+{
+  /* Create the SPI event header followed by the event name as a */
+  /* messagePack string; returns the size or zero if the name is invalid. */
+  /* If copyName is FALSE only the messagePack string header is created */
+  /* and the name should be sent from where it is. */
+
+  uint8_t headerSize = SPI_EVENT_HEADER_SIZE_BYTES + 1; /* +1 for messagePack fixraw byte */
+
+  if ((eventName == NULL) || (eventName[0] == '\0'))
+  {
+    _LOG("Event name must be at least one character.\r\n");
+    return 0;
+  }
+
+  /* Create SPI header */
+  header[0] = BC_EVENT_NAMED_PACKED & BC_EVENT_ID_MASK;
+  header[1] = 0;
+  header[2] = 0;
+  header[3] = 0;
+
+  /* Create string header in messagePack format */
+  header[4] = _MP_FIXRAW_MIN;
+  while ((*eventName != '\0') && (headerSize < _BC_EVENT_HEADER_MAX_SIZE))
+  {
+    /* Copy string, update messagePack byte */
+    if (copyName)
+    {
+      header[headerSize] = *eventName;
+    }
+
+    header[4]++;
+    headerSize++;
+    eventName++;
+  }
+
+  return headerSize;
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+uint8_t *BERGCloudBase::createEventHeader(BERGCloudMessageBuffer& buffer, const char *eventName, uint16_t& eventSize)
+{
+  /* Create the event header in the headroom in front of the buffer's */
+  /* data; returns the start of the event, or NULL if there is not */
+  /* enough headroom or the name is invalid */
+
+  uint8_t headerSize = SPI_EVENT_HEADER_SIZE_BYTES + 1; /* +1 for messagePack fixraw byte */
+  uint8_t nameSize = 0;
+  uint8_t *header;
+
+  if ((eventName == NULL) || (eventName[0] == '\0'))
+  {
+    return NULL;
+  }
+
+  /* Names are truncated in the same way as createEventHeader() */
+  while ((eventName[nameSize] != '\0') && ((headerSize + nameSize) < _BC_EVENT_HEADER_MAX_SIZE))
+  {
+    nameSize++;
+  }
+
+  headerSize += nameSize;
+
+  if (buffer.headroom() < headerSize)
+  {
+    return NULL;
+  }
+
+  header = buffer.ptr() - headerSize;
+  createEventHeader(header, eventName);
+
+  eventSize = headerSize + buffer.used();
+  return header;
+}
+#endif
+
+bool BERGCloudBase::findCommandName(uint8_t *cmdID, uint8_t *commandBuffer, uint16_t commandSize, uint8_t& commandNameSize)
+{
+  /* Check for a named command; the name follows a messagePack fixraw */
+  /* byte at the start of the buffer, and the packed data follows that */
+
+  uint8_t msgPackByte;
+  uint16_t command;
+
+  command = (cmdID[0] << 8) | cmdID[1];
+  if ((command != BC_COMMAND_NAMED_PACKED) || (commandSize < 1))
+  {
+    return false;
+  }
+
+  /* Get command name string size */
+  msgPackByte = *commandBuffer;
+
+  if ((msgPackByte <_MP_FIXRAW_MIN) || (msgPackByte > _MP_FIXRAW_MAX))
+  {
+    /* Invalid */
+    return false;
+  }
+
+  commandNameSize = msgPackByte - _MP_FIXRAW_MIN;
 
-  if ((eventName == NULL) || (eventName[0] == '\0'))
+  if ((commandNameSize + 1) > commandSize) /* +1 for messagePack fixraw byte */
   {
-    _LOG("Event name must be at least one character.\r\n");
+    /* Truncated */
     return false;
   }
 
-  /* Create SPI header */
-  header[0] = BC_EVENT_NAMED_PACKED & BC_EVENT_ID_MASK;
-  header[1] = 0;
-  header[2] = 0;
-  header[3] = 0;
+  return true;
+}
 
-  /* Create string header in messagePack format */
-  header[4] = _MP_FIXRAW_MIN;
-  while ((*eventName != '\0') && (headerSize < sizeof(header)))
+void BERGCloudBase::copyCommandName(const uint8_t *name, uint8_t nameSize, char *commandName, uint8_t commandNameMaxSize)
+{
+  /* Copy a command name as a null-terminated C string */
+
+  /* Limit to the size of the buffer provided */
+  if (nameSize > (commandNameMaxSize-1)) /* -1 for null terminator */
   {
-    /* Copy string, update messagePack byte */
-    header[4]++;
-    header[headerSize++] = *eventName++;
+    nameSize = (commandNameMaxSize-1);
   }
 
-  if (buffer.used() > ((uint16_t)SPI_MAX_PAYLOAD_SIZE_BYTES - headerSize))
+  memcpy(commandName, name, nameSize);
+  commandName[nameSize] = '\0';
+}
+
+bool BERGCloudBase::getCommandName(uint8_t *cmdID, uint8_t *commandBuffer, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize)
+{
+  /* Split a named command into a null-terminated name and the packed */
+  /* data, which is moved to the start of the buffer */
+
+  uint8_t commandNameSize;
+
+  if (!findCommandName(cmdID, commandBuffer, commandSize, commandNameSize))
   {
-    _LOG("Event is too big.\r\n");
     return false;
   }
 
-  initTransaction(&tr);
-
-  tr.command = SPI_CMD_SEND_EVENT_PACKED;
-  tr.tx[0].buffer = (uint8_t *)header;
-  tr.tx[0].dataSize = headerSize;
-  tr.tx[1].buffer = buffer.ptr();
-  tr.tx[1].dataSize = buffer.used();
+  copyCommandName(commandBuffer + 1, commandNameSize, commandName, commandNameMaxSize); /* +1 for messagePack fixraw byte */
 
-  return transaction(&tr);
+  /* Move up remaining packed data, update size */
+  commandSize -= (commandNameSize + 1); /* +1 for messagePack fixraw byte */
+  bytecpy(commandBuffer, commandBuffer + (commandNameSize + 1), commandSize);
+  return true;
 }
-#endif
 
 bool BERGCloudBase::getConnectionState(uint8_t& state)
 {
@@ -658,15 +1778,12 @@ bool BERGCloudBase::getSignalQuality(int8_t& rssi, uint8_t& lqi)
   return transaction(&tr);
 }
 
-bool BERGCloudBase::connect(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t version, bool waitForConnected)
+bool BERGCloudBase::sendAnnounce(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t version)
 {
   _BC_SPI_TRANSACTION tr;
   uint16_t hostType = BC_HOST_UNKNOWN;
   uint8_t connectData [sizeof(version) + sizeof(hostType)];
 
-  uint8_t lastState = BC_CONNECT_STATE_DISCONNECTED;
-  uint8_t state;
-
 #ifndef BERGCLOUD_NO_HOST_TYPE
   /* Get host type */
   hostType = getHostType();
@@ -685,55 +1802,146 @@ bool BERGCloudBase::connect(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t ve
   tr.tx[1].buffer = connectData;
   tr.tx[1].dataSize = sizeof(connectData);
 
-  if (!transaction(&tr))
+  return transaction(&tr);
+}
+
+bool BERGCloudBase::connect(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t version, bool waitForConnected)
+{
+  uint8_t status;
+
+  if (!waitForConnected)
+  {
+    return sendAnnounce(key, version);
+  }
+
+  if (!connectAsync(key, version))
   {
     return false;
   }
 
-  if (waitForConnected)
+  /* Poll until connected */
+  while ((status = connectService()) == BC_TRANSACTION_IN_PROGRESS)
   {
-    /* Poll until connected */
-    do {
-      timerReset();
-      while (timerRead_mS() < CONNECT_POLL_RATE_MS);
+    timerWait_uS(1000);
+  }
 
-      if (!getConnectionState(state))
-      {
-        return false;
-      }
+  return (status == BC_TRANSACTION_DONE);
+}
 
-      if (state != lastState)
-      {
-        switch (state)
-        {
-          case BC_CONNECT_STATE_CONNECTED:
-            _LOG("connect: Connected\r\n");
-            break;
-          case BC_CONNECT_STATE_CONNECTING:
-            _LOG("connect: Connecting...\r\n");
-            break;
-          default:
-          case BC_CONNECT_STATE_DISCONNECTED:
-            _LOG("connect: Disconnected\r\n");
-            break;
-        }
+bool BERGCloudBase::connect(const char *key, uint16_t version, bool waitForConnected)
+{
+  uint8_t _key[BC_KEY_SIZE_BYTES] = {0};
 
-        lastState = state;
-      }
+  keyFromString(key, _key);
+  return connect(_key, version, waitForConnected);
+}
+
+bool BERGCloudBase::connectAsync(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t version, uint32_t deadline_mS, uint32_t pollInterval_mS)
+{
+  /* Returns TRUE if the announce was sent */
+
+  connection.status = BC_TRANSACTION_IDLE;
 
-    } while (state != BC_CONNECT_STATE_CONNECTED);
+  if (!sendAnnounce(key, version))
+  {
+    return false;
   }
 
+  connection.status = BC_TRANSACTION_IN_PROGRESS;
+  connection.state = BC_CONNECT_STATE_DISCONNECTED;
+  connection.deadline_mS = deadline_mS;
+  connection.pollInterval_mS = pollInterval_mS;
+  timerStart(&connection.timer);
+  timerStart(&connection.pollTimer);
+
   return true;
 }
 
-bool BERGCloudBase::connect(const char *key, uint16_t version, bool waitForConnected)
+bool BERGCloudBase::connectAsync(const char *key, uint16_t version, uint32_t deadline_mS, uint32_t pollInterval_mS)
 {
-  unsigned int tmp_key[BC_KEY_SIZE_BYTES] = {0};
   uint8_t _key[BC_KEY_SIZE_BYTES] = {0};
+
+  keyFromString(key, _key);
+  return connectAsync(_key, version, deadline_mS, pollInterval_mS);
+}
+
+uint8_t BERGCloudBase::connectService(void)
+{
+  uint8_t state;
+
+  if (connection.status != BC_TRANSACTION_IN_PROGRESS)
+  {
+    return connection.status;
+  }
+
+  if (timerElapsed_mS(&connection.pollTimer) < connection.pollInterval_mS)
+  {
+    /* Not time to poll yet */
+    return connection.status;
+  }
+
+  timerStart(&connection.pollTimer);
+
+  if (!getConnectionState(state))
+  {
+    if (getLastStatus() != BC_TRANSACTION_BUSY)
+    {
+      connection.status = BC_TRANSACTION_FAILED;
+    }
+
+    /* Otherwise try again at the next poll */
+    return connection.status;
+  }
+
+  if (state != connection.state)
+  {
+    switch (state)
+    {
+      case BC_CONNECT_STATE_CONNECTED:
+        _LOG("connect: Connected\r\n");
+        break;
+      case BC_CONNECT_STATE_CONNECTING:
+        _LOG("connect: Connecting...\r\n");
+        break;
+      default:
+      case BC_CONNECT_STATE_DISCONNECTED:
+        _LOG("connect: Disconnected\r\n");
+        break;
+    }
+
+    connection.state = state;
+
+    if (connectCallback != NULL)
+    {
+      connectCallback(this, state);
+    }
+  }
+
+  if (state == BC_CONNECT_STATE_CONNECTED)
+  {
+    connection.status = BC_TRANSACTION_DONE;
+  }
+  else if ((connection.deadline_mS > 0) && (timerElapsed_mS(&connection.timer) >= connection.deadline_mS))
+  {
+    _LOG("Timeout (BERGCloudBase::connectService)\r\n");
+    connection.status = BC_TRANSACTION_FAILED;
+  }
+
+  return connection.status;
+}
+
+void BERGCloudBase::setConnectCallback(void (*callback)(BERGCloudBase *bergcloud, uint8_t state))
+{
+  connectCallback = callback;
+}
+
+void BERGCloudBase::keyFromString(const char *key, uint8_t (&_key)[BC_KEY_SIZE_BYTES])
+{
+  /* Convert key from ASCII; unchanged if the string is invalid */
+
+  unsigned int tmp_key[BC_KEY_SIZE_BYTES] = {0};
   uint8_t i;
 
-  /* Convert key from ASCII */
   if (key != NULL)
   {
     if (sscanf(key, "%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x%2x",
@@ -748,8 +1956,6 @@ bool BERGCloudBase::connect(const char *key, uint16_t version, bool waitForConne
       }
     }
   }
-
-  return connect(_key, version, waitForConnected);
 }
 
 bool BERGCloudBase::getClaimingState(uint8_t& state)
@@ -853,13 +2059,20 @@ bool BERGCloudBase::display(const char *text)
 uint16_t BERGCloudBase::Crc16(uint8_t data, uint16_t crc)
 {
   /* CRC16 CCITT (0x1021) */
+  return crc16(&data, 1, crc);
+}
+
+uint16_t BERGCloudBase::SPITransactionSegments(BERGCloudSPISegment *segment, uint8_t count, bool finalCS)
+{
+  uint16_t dataSize = 0;
+  uint8_t i;
 
-  uint8_t s;
-  uint16_t t;
+  for (i=0; i<count; i++)
+  {
+    dataSize += SPITransaction(segment[i].dataOut, segment[i].dataIn, segment[i].dataSize, finalCS && (i == (count - 1)));
+  }
 
-  s = data ^ (crc >> 8);
-  t = s ^ (s >> 4);
-  return (crc << 8) ^ t ^ (t << 5) ^ (t << 12);
+  return dataSize;
 }
 
 uint8_t BERGCloudBase::SPITransaction(uint8_t dataOut, bool finalCS)
@@ -871,18 +2084,298 @@ uint8_t BERGCloudBase::SPITransaction(uint8_t dataOut, bool finalCS)
   return dataIn;
 }
 
+uint8_t BERGCloudBase::getLastResponse(void)
+{
+  uint8_t response;
+
+  lockTake();
+  response = lastResponse;
+  lockRelease();
+
+  return response;
+}
+
+uint8_t BERGCloudBase::getLastStatus(void)
+{
+  uint8_t status;
+
+  lockTake();
+  status = lastStatus;
+  lockRelease();
+
+  return status;
+}
+
+void BERGCloudBase::setPollPolicy(const BERGCloudPollPolicy *policy)
+{
+  if (policy == NULL)
+  {
+    pollPolicy.spinProbes = BC_POLL_SPIN_PROBES;
+    pollPolicy.minGap_uS = BC_POLL_MIN_GAP_US;
+    pollPolicy.maxGap_uS = BC_POLL_MAX_GAP_US;
+    pollPolicy.gapCallback = NULL;
+    return;
+  }
+
+  pollPolicy = *policy;
+}
+
+uint32_t BERGCloudBase::pollGap_uS(uint32_t probes)
+{
+  /* Get the gap to leave before sending probe byte number 'probes' */
+
+  uint32_t gap;
+
+  if ((probes < pollPolicy.spinProbes) || (pollPolicy.minGap_uS == 0))
+  {
+    return 0;
+  }
+
+  gap = pollPolicy.minGap_uS;
+  probes -= pollPolicy.spinProbes;
+
+  while ((probes > 0) && (gap < pollPolicy.maxGap_uS))
+  {
+    gap <<= 1;
+    probes--;
+  }
+
+  if (gap > pollPolicy.maxGap_uS)
+  {
+    gap = pollPolicy.maxGap_uS;
+  }
+
+  return gap;
+}
+
+void BERGCloudBase::timerStart(_BC_TIMER *timer)
+{
+  timer->start = timerNow_mS();
+}
+
+uint32_t BERGCloudBase::timerElapsed_mS(_BC_TIMER *timer)
+{
+  return timerNow_mS() - timer->start;
+}
+
+void BERGCloudBase::timerStart_uS(_BC_TIMER *timer)
+{
+  timer->start_uS = timerNow_uS();
+}
+
+uint32_t BERGCloudBase::timerElapsed_uS(_BC_TIMER *timer)
+{
+  return timerNow_uS() - timer->start_uS;
+}
+
+uint32_t BERGCloudBase::timerNow_mS(void)
+{
+  return timerRead_mS();
+}
+
+uint32_t BERGCloudBase::timerNow_uS(void)
+{
+  return timerNow_mS() * 1000;
+}
+
+void BERGCloudBase::timerWait_uS(uint32_t time_uS)
+{
+  _BC_TIMER timer;
+
+  timerStart_uS(&timer);
+
+  while (timerElapsed_uS(&timer) < time_uS)
+  {
+  }
+}
+
+void BERGCloudBase::SPIDeselect(void)
+{
+}
+
 void BERGCloudBase::lockTake(void)
 {
+#ifndef BERGCLOUD_LOCK_NONE
+  uint32_t start;
+  uint32_t wait;
+
+  start = lockClock_uS();
+
+#ifdef BERGCLOUD_LOCK_PTHREAD
+  if (pthread_mutex_trylock(&lock) != 0)
+  {
+    pthread_mutex_lock(&lock);
+    lockStats.contended++;
+  }
+#else
+  BERGCloudLockTake(lockContext);
+#endif
+
+  /* The statistics are only updated while the lock is held */
+  lockTaken_uS = lockClock_uS();
+  wait = lockTaken_uS - start;
+
+#ifdef BERGCLOUD_LOCK_USER
+  if (wait > 0)
+  {
+    /* Can't tell directly if BERGCloudLockTake() had to wait */
+    lockStats.contended++;
+  }
+#endif
+
+  lockStats.takes++;
+  lockStats.waitTotal_uS += wait;
+
+  if (wait > lockStats.waitMax_uS)
+  {
+    lockStats.waitMax_uS = wait;
+  }
+#endif // #ifndef BERGCLOUD_LOCK_NONE
 }
 
 void BERGCloudBase::lockRelease(void)
 {
+#ifndef BERGCLOUD_LOCK_NONE
+  uint32_t hold;
+
+  hold = lockClock_uS() - lockTaken_uS;
+  lockStats.holdTotal_uS += hold;
+
+  if (hold > lockStats.holdMax_uS)
+  {
+    lockStats.holdMax_uS = hold;
+  }
+
+#ifdef BERGCLOUD_LOCK_PTHREAD
+  pthread_mutex_unlock(&lock);
+#else
+  BERGCloudLockRelease(lockContext);
+#endif
+#endif // #ifndef BERGCLOUD_LOCK_NONE
+}
+
+#ifdef BERGCLOUD_STATS
+void BERGCloudBase::getStats(BERGCloudStats& snapshot)
+{
+  /* Copy while no transaction is updating them */
+  lockTake();
+  snapshot = stats;
+  lockRelease();
+}
+
+void BERGCloudBase::clearStats(void)
+{
+  lockTake();
+  memset(&stats, 0x00, sizeof(stats));
+  lockRelease();
+}
+
+uint8_t BERGCloudBase::statsCommandIndex(uint8_t command)
+{
+  switch (command)
+  {
+    case SPI_CMD_GET_CONNECT_STATE:  return 0;
+    case SPI_CMD_GET_CLAIMCODE:      return 1;
+    case SPI_CMD_GET_CLAIM_STATE:    return 2;
+    case SPI_CMD_GET_SIGNAL_QUALITY: return 3;
+    case SPI_CMD_GET_EUI64:          return 4;
+    case SPI_CMD_SEND_ANNOUNCE:      return 5;
+    case SPI_CMD_GET_ADDRESS:        return 6;
+    case SPI_CMD_POLL_FOR_COMMAND:   return 7;
+    case SPI_CMD_SET_DISPLAY_STYLE:  return 8;
+    case SPI_CMD_DISPLAY_PRINT:      return 9;
+    case SPI_CMD_SEND_EVENT_RAW:     return 10;
+    case SPI_CMD_SEND_EVENT_PACKED:  return 11;
+    default:                         return BC_STATS_COMMANDS - 1;
+  }
+}
+
+void BERGCloudBase::statsBegin(uint8_t command)
+{
+  statsCurrent.command = command;
+  statsCurrent.bytesSent = 0;
+  statsCurrent.bytesReceived = 0;
+  timerStart_uS(&statsCurrent.timer);
+}
+
+void BERGCloudBase::statsLatency(uint32_t *histogram)
+{
+  /* Add the time since the last phase ended to a histogram */
+
+  uint32_t latency = timerElapsed_uS(&statsCurrent.timer);
+  uint8_t bucket = 0;
+
+  timerStart_uS(&statsCurrent.timer);
+
+  while ((latency > 0) && (bucket < (BC_STATS_LATENCY_BUCKETS - 1)))
+  {
+    latency >>= 1;
+    bucket++;
+  }
+
+  histogram[bucket]++;
+}
+
+void BERGCloudBase::statsEnd(void)
+{
+  BERGCloudCommandStats *command = &stats.command[statsCommandIndex(statsCurrent.command)];
+
+  command->transactions++;
+  command->bytesSent += statsCurrent.bytesSent;
+  command->bytesReceived += statsCurrent.bytesReceived;
+}
+#endif // #ifdef BERGCLOUD_STATS
+
+#ifndef BERGCLOUD_LOCK_NONE
+void BERGCloudBase::getLockStats(BERGCloudLockStats& stats)
+{
+  /* Copy while no transaction is updating them */
+  lockTake();
+  stats = lockStats;
+  lockRelease();
+}
+
+void BERGCloudBase::clearLockStats(void)
+{
+  lockTake();
+  memset(&lockStats, 0x00, sizeof(lockStats));
+  lockRelease();
+}
+
+uint32_t BERGCloudBase::lockClock_uS(void)
+{
+#ifdef BERGCLOUD_LOCK_PTHREAD
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint32_t)ts.tv_sec * 1000000) + (uint32_t)(ts.tv_nsec / 1000);
+#else
+  return timerNow_uS();
+#endif
+}
+#endif // #ifndef BERGCLOUD_LOCK_NONE
+
+#ifdef BERGCLOUD_LOCK_USER
+void BERGCloudBase::setLockContext(void *context)
+{
+  lockContext = context;
 }
+#endif
 
 void BERGCloudBase::begin(void)
 {
   synced = false;
   lastResponse = SPI_RSP_SUCCESS;
+  lastStatus = BC_TRANSACTION_IDLE;
+  lastPollProbes = 0;
+  /* Start of the count returned by the default timerNow_mS() */
+  timerReset();
+  connection.status = BC_TRANSACTION_IDLE;
+  connection.state = BC_CONNECT_STATE_DISCONNECTED;
+#ifdef BERGCLOUD_ASYNC
+  async.status = BC_TRANSACTION_IDLE;
+  async.response = SPI_RSP_SUCCESS;
+#endif
 
   /* Print library version */
   _LOG("\r\nBERGCloud library version ");
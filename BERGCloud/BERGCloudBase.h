@@ -31,15 +31,40 @@ THE SOFTWARE.
 #include "BERGCloudConfig.h"
 #include "BERGCloudConst.h"
 #include "BERGCloudLogPrint.h"
+#include "BERGCloudMessagePack.h"
+#include "BERGCloudEventName.h"
 
 #ifdef BERGCLOUD_PACK_UNPACK
 #include "BERGCloudMessageBuffer.h"
 #endif
 
+#ifdef BERGCLOUD_LOCK_PTHREAD
+#include <pthread.h>
+#endif
+
+#ifdef BERGCLOUD_LOCK_USER
+/* Provided by the application, e.g. to take and release an RTOS mutex; */
+/* 'context' is the value given to setLockContext() */
+extern void BERGCloudLockTake(void *context);
+extern void BERGCloudLockRelease(void *context);
+#endif
+
 #define BERGCLOUD_LIB_VERSION (0x0200)
 
-#define _TX_GROUPS (2)
-#define _RX_GROUPS (2)
+#define _TX_GROUPS (BC_TX_SEGMENTS)
+#define _RX_GROUPS (BC_RX_SEGMENTS)
+
+#if (_TX_GROUPS < 2) || (_RX_GROUPS < 2)
+#error BC_TX_SEGMENTS and BC_RX_SEGMENTS must be at least 2
+#endif
+
+/* Most segments passed to SPITransactionSegments(): the request header, */
+/* data and footer, or the response data and footer */
+#if ((_TX_GROUPS + 2) > (_RX_GROUPS + 1))
+#define BC_SPI_MAX_SEGMENTS (_TX_GROUPS + 2)
+#else
+#define BC_SPI_MAX_SEGMENTS (_RX_GROUPS + 1)
+#endif
 
 typedef struct {
   uint8_t *buffer;
@@ -58,15 +83,149 @@ typedef struct {
   _BC_RX_GROUP rx[_RX_GROUPS];
 } _BC_SPI_TRANSACTION;
 
+/* One buffer of a transfer made up of several */
+typedef struct {
+  uint8_t *dataOut;
+  uint8_t *dataIn;
+  uint16_t dataSize;
+} BERGCloudSPISegment;
+
+/* SPI event header plus a messagePack fixraw name of up to 31 characters */
+#define _BC_EVENT_HEADER_MAX_SIZE (SPI_EVENT_HEADER_SIZE_BYTES + 1 + _MAX_FIXRAW)
+
+/* Start time for timerElapsed_mS() or timerElapsed_uS(); one per */
+/* timeout or measurement so they don't share a reset point */
+typedef struct {
+  uint32_t start;
+  uint32_t start_uS;
+} _BC_TIMER;
+
+typedef struct {
+  /* Probe bytes sent back-to-back before backing off */
+  uint16_t spinProbes;
+  /* First gap between probe bytes; doubles after each probe */
+  uint16_t minGap_uS;
+  /* Largest gap between probe bytes */
+  uint16_t maxGap_uS;
+  /* If not NULL, called for each gap instead of waiting; should */
+  /* return after roughly gap_uS. nCS remains asserted and the lock */
+  /* is held, so the callback must not call this object or use the */
+  /* SPI bus, and other threads using this shield wait until the */
+  /* transaction ends. It may do work that doesn't touch the shield. */
+  void (*gapCallback)(uint32_t gap_uS);
+} BERGCloudPollPolicy;
+
+#ifdef BERGCLOUD_ASYNC
+typedef struct {
+  uint8_t status;
+  uint8_t phase;
+  uint8_t segment;
+  uint16_t offset;
+  uint8_t dataSize;
+  uint16_t calcCRC;
+  uint16_t dataCRC;
+  _BC_TIMER timer;
+  _BC_TIMER gapTimer;
+  _BC_SPI_TRANSACTION tr;
+  uint8_t response;
+  uint8_t header[SPI_HEADER_SIZE_BYTES];
+  uint8_t footer[SPI_FOOTER_SIZE_BYTES];
+  /* For SPI_CMD_POLL_FOR_COMMAND */
+  uint8_t cmdID[2];
+  uint16_t commandSize;
+  uint16_t *commandSizeOut;
+  char *commandName;
+  uint8_t commandNameMaxSize;
+#ifdef BERGCLOUD_PACK_UNPACK
+  BERGCloudMessageBuffer *buffer;
+#endif
+  /* For SPI_CMD_SEND_EVENT_PACKED; holds a copy of the name */
+  uint8_t eventHeader[_BC_EVENT_HEADER_MAX_SIZE];
+} _BC_ASYNC_TRANSACTION;
+#endif // #ifdef BERGCLOUD_ASYNC
+
+#ifdef BERGCLOUD_STATS
+/* Number of SPI_CMD_ codes counted separately, plus one for any other */
+/* command; see statsCommandIndex() */
+#define BC_STATS_COMMANDS           13
+/* SPI_RSP_ codes, plus one for any other response */
+#define BC_STATS_RESPONSES          (SPI_RSP_NO_FREE_BUFFERS + 2)
+/* Bucket n counts latencies of 2^(n-1) to 2^n - 1 uS; bucket 0 counts */
+/* zero and the last bucket counts anything longer */
+#define BC_STATS_LATENCY_BUCKETS    24
+
+typedef struct {
+  uint32_t transactions;
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+} BERGCloudCommandStats;
+
+typedef struct {
+  BERGCloudCommandStats command[BC_STATS_COMMANDS];
+  uint32_t response[BC_STATS_RESPONSES];
+  uint32_t crcErrors;
+  uint32_t resyncs;
+  uint32_t syncTimeouts;
+  uint32_t pollTimeouts;
+  /* Unexpected bytes echoed while sending a request */
+  uint32_t syncErrors;
+  /* Shield resets seen during a transaction */
+  uint32_t resets;
+  /* Sync and send the request, wait for the response, read it */
+  uint32_t requestLatency[BC_STATS_LATENCY_BUCKETS];
+  uint32_t waitLatency[BC_STATS_LATENCY_BUCKETS];
+  uint32_t responseLatency[BC_STATS_LATENCY_BUCKETS];
+} BERGCloudStats;
+
+typedef struct {
+  uint8_t command;
+  uint16_t bytesSent;
+  uint16_t bytesReceived;
+  _BC_TIMER timer;
+} _BC_STATS_TRANSACTION;
+#endif // #ifdef BERGCLOUD_STATS
+
+typedef struct {
+  uint8_t status;
+  uint8_t state;
+  uint32_t deadline_mS;
+  uint32_t pollInterval_mS;
+  _BC_TIMER timer;
+  _BC_TIMER pollTimer;
+} _BC_CONNECT;
+
+#ifndef BERGCLOUD_LOCK_NONE
+typedef struct {
+  /* Number of times the lock was taken, and how many had to wait */
+  uint32_t takes;
+  uint32_t contended;
+  uint64_t waitTotal_uS;
+  uint32_t waitMax_uS;
+  uint64_t holdTotal_uS;
+  uint32_t holdMax_uS;
+} BERGCloudLockStats;
+#endif
+
 class BERGCloudBase
 {
 public:
+  BERGCloudBase(void);
+  virtual ~BERGCloudBase(void);
   /* Check for a command */
   bool pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, uint8_t& commandID);
   bool pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize);
+  /* As above, but without copying the name and without dropping */
+  /* commands that have no name; commandName points into the buffer, */
+  /* is not null-terminated and is followed by the commandSize bytes */
+  /* of data. An unnamed command has a commandNameSize of 0. */
+  bool pollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, const char *&commandName, uint8_t& commandNameSize);
 #ifdef BERGCLOUD_PACK_UNPACK
   bool pollForCommand(BERGCloudMessageBuffer& buffer, uint8_t& commandID);
   bool pollForCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize);
+  /* As above, but without copying the name; commandName points into */
+  /* the buffer's headroom, is not null-terminated and is valid until */
+  /* the buffer is next used */
+  bool pollForCommand(BERGCloudMessageBuffer& buffer, const char *&commandName, uint8_t& commandNameSize);
 #endif
   /* Send an event */
   bool sendEvent(uint8_t eventCode, uint8_t *eventBuffer, uint16_t eventSize, bool packed = true);
@@ -75,6 +234,21 @@ public:
   bool sendEvent(uint8_t eventCode, BERGCloudMessageBuffer& buffer);
   bool sendEvent(const char *eventName, BERGCloudMessageBuffer& buffer);
 #endif
+#if (__cplusplus >= 201103L)
+  /* Send an event using a name declared with BERGCLOUD_EVENT_NAME() */
+  template <size_t L>
+  bool sendEvent(const BERGCloudEventName<L>& eventName, uint8_t *eventBuffer, uint16_t eventSize)
+  {
+    return sendEncodedEvent(eventName.header, sizeof(eventName.header), eventBuffer, eventSize);
+  }
+#ifdef BERGCLOUD_PACK_UNPACK
+  template <size_t L>
+  bool sendEvent(const BERGCloudEventName<L>& eventName, BERGCloudMessageBuffer& buffer)
+  {
+    return sendEncodedEvent(eventName.header, sizeof(eventName.header), buffer);
+  }
+#endif
+#endif // #if (__cplusplus >= 201103L)
   /* Get the connection state */
   bool getConnectionState(uint8_t& state);
   /* Get the last-hop signal quality */
@@ -82,6 +256,14 @@ public:
   /* Connect */
   virtual bool connect(const uint8_t (&key)[BC_KEY_SIZE_BYTES] = nullKey, uint16_t version = 0, bool waitForConnected = false);
   virtual bool connect(const char *key = NULL, uint16_t version = 0, bool waitForConnected = false);
+  /* Connect without waiting; call connectService() regularly until it */
+  /* returns BC_TRANSACTION_DONE, or BC_TRANSACTION_FAILED if not */
+  /* connected within deadline_mS. Zero for no deadline. */
+  bool connectAsync(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t version = 0, uint32_t deadline_mS = 0, uint32_t pollInterval_mS = BC_CONNECT_POLL_INTERVAL_MS);
+  bool connectAsync(const char *key, uint16_t version = 0, uint32_t deadline_mS = 0, uint32_t pollInterval_mS = BC_CONNECT_POLL_INTERVAL_MS);
+  uint8_t connectService(void);
+  /* Called by connectService() when the connection state changes */
+  void setConnectCallback(void (*callback)(BERGCloudBase *bergcloud, uint8_t state));
   /* Check if the device has been claimed */
   bool getClaimingState(uint8_t& state);
   /* Get the current claimcode */
@@ -96,18 +278,96 @@ public:
   bool clearDisplay(void);
   /* Display a line of text on the OLED display */
   bool display(const char *text);
+  /* Set how to poll for a response from the shield; NULL for the */
+  /* default. The gap callback runs inside the transaction, see */
+  /* BERGCloudPollPolicy: it must not call back into the library. */
+  void setPollPolicy(const BERGCloudPollPolicy *policy);
+#ifdef BERGCLOUD_STATS
+  /* Get or clear the transport statistics */
+  void getStats(BERGCloudStats& snapshot);
+  void clearStats(void);
+  /* Index into BERGCloudStats.command for an SPI_CMD_ code */
+  static uint8_t statsCommandIndex(uint8_t command);
+#endif
+#ifndef BERGCLOUD_LOCK_NONE
+  /* Get or clear the time spent waiting for and holding the lock */
+  void getLockStats(BERGCloudLockStats& stats);
+  void clearLockStats(void);
+#endif
+#ifdef BERGCLOUD_LOCK_USER
+  /* Set the value passed to BERGCloudLockTake() and BERGCloudLockRelease() */
+  void setLockContext(void *context);
+#endif
+#ifdef BERGCLOUD_ASYNC
+  /* Start sending an event or checking for a command without blocking; */
+  /* event names are copied, but buffers must remain valid until step() */
+  /* returns BC_TRANSACTION_DONE or BC_TRANSACTION_FAILED */
+  bool beginSendEvent(const char *eventName, uint8_t *eventBuffer, uint16_t eventSize, bool packed = true);
+  bool beginPollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize);
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool beginSendEvent(const char *eventName, BERGCloudMessageBuffer& buffer);
+  bool beginPollForCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize);
+#endif
+  /* Advance a transaction started with begin...() by up to maxBytes */
+  /* SPI bytes; returns a BC_TRANSACTION_ status. nCS stays low between */
+  /* calls until the transaction ends, so with several shields on one */
+  /* SPI bus, finish it before using another shield; BERGCloudRoundRobin */
+  /* does this for events. */
+  uint8_t step(uint16_t maxBytes = BC_STEP_MAX_BYTES);
+  /* Get the status of the last transaction started with begin...() */
+  uint8_t stepStatus(void);
+  /* Get the response code of that transaction; SPI_RSP_SUCCESS if it */
+  /* failed before a response was read */
+  uint8_t stepResponse(void);
+#endif
+
+  /* Get the response code of the last transaction; with several */
+  /* threads, use this rather than reading lastResponse directly */
+  uint8_t getLastResponse(void);
+  /* Get how the last transaction ended: BC_TRANSACTION_DONE if the */
+  /* shield responded, with the code from getLastResponse(), */
+  /* BC_TRANSACTION_FAILED on a transport error or BC_TRANSACTION_BUSY */
+  /* if it could not start, as a begin...() transaction was in progress */
+  uint8_t getLastStatus(void);
 
   /* Internal methods */
 public:
   uint8_t lastResponse;
+  /* Number of probe bytes sent while polling for the last response */
+  uint32_t lastPollProbes;
   static uint8_t nullKey[BC_KEY_SIZE_BYTES];
+  /* Timers using the backend's clock; one _BC_TIMER per timeout or */
+  /* measurement */
+  void timerStart(_BC_TIMER *timer);
+  uint32_t timerElapsed_mS(_BC_TIMER *timer);
+  /* For intervals of up to 71 minutes */
+  void timerStart_uS(_BC_TIMER *timer);
+  uint32_t timerElapsed_uS(_BC_TIMER *timer);
 protected:
   void begin(void);
   void end(void);
   uint16_t Crc16(uint8_t data, uint16_t crc);
+  /* Full-duplex transfer; dataOut and dataIn may be the same buffer */
   virtual uint16_t SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS) = 0;
+  /* Transfer several segments back-to-back as one transfer, e.g. with */
+  /* one DMA or driver operation; nCS stays low between segments. The */
+  /* default makes one SPITransaction() call per segment. */
+  virtual uint16_t SPITransactionSegments(BERGCloudSPISegment *segment, uint8_t count, bool finalCS);
+  /* Set nCS high, e.g. after a transaction ends early, so that this */
+  /* shield ignores traffic to other shields on the same bus. The */
+  /* default does nothing. */
+  virtual void SPIDeselect(void);
   virtual void timerReset(void) = 0;
   virtual uint32_t timerRead_mS(void) = 0;
+  /* Free-running millisecond count; the default is timerRead_mS(), */
+  /* as the timer is only reset by begin() */
+  virtual uint32_t timerNow_mS(void);
+  /* Free-running microsecond count; the default has millisecond */
+  /* resolution. Named "Now" rather than "Read" because it is never */
+  /* reset, whereas timerRead_mS() counts from the last timerReset(). */
+  virtual uint32_t timerNow_uS(void);
+  /* Wait without clocking the SPI bus; the default polls timerNow_uS() */
+  virtual void timerWait_uS(uint32_t time_uS);
   virtual uint16_t getHostType(void) = 0;
 private:
   uint8_t SPITransaction(uint8_t data, bool finalCS);
@@ -115,10 +375,57 @@ private:
   bool _transaction(_BC_SPI_TRANSACTION *tr);
   bool transaction(_BC_SPI_TRANSACTION *tr);
   bool _sendEvent(uint8_t eventCode, uint8_t *eventBuffer, uint16_t eventSize, uint8_t command);
+  uint8_t createEventHeader(uint8_t *header, const char *eventName, bool copyName = true);
+  bool sendEncodedEvent(const uint8_t *header, uint8_t headerSize, uint8_t *eventBuffer, uint16_t eventSize);
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool sendEncodedEvent(const uint8_t *header, uint8_t headerSize, BERGCloudMessageBuffer& buffer);
+  uint8_t *createEventHeader(BERGCloudMessageBuffer& buffer, const char *eventName, uint16_t& eventSize);
+#endif
+  bool findCommandName(uint8_t *cmdID, uint8_t *commandBuffer, uint16_t commandSize, uint8_t& commandNameSize);
+  void copyCommandName(const uint8_t *name, uint8_t nameSize, char *commandName, uint8_t commandNameMaxSize);
+  bool getCommandName(uint8_t *cmdID, uint8_t *commandBuffer, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize);
+  uint32_t pollGap_uS(uint32_t probes);
+  bool sendAnnounce(const uint8_t (&key)[BC_KEY_SIZE_BYTES], uint16_t version);
+  void keyFromString(const char *key, uint8_t (&_key)[BC_KEY_SIZE_BYTES]);
+  _BC_CONNECT connection;
+#ifdef BERGCLOUD_STATS
+  void statsBegin(uint8_t command);
+  void statsLatency(uint32_t *histogram);
+  void statsEnd(void);
+  BERGCloudStats stats;
+  _BC_STATS_TRANSACTION statsCurrent;
+#endif
+  void (*connectCallback)(BERGCloudBase *bergcloud, uint8_t state);
+  BERGCloudPollPolicy pollPolicy;
+#ifdef BERGCLOUD_ASYNC
+  bool beginTransaction(void);
+  void initPollForCommand(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t *commandSize, char *commandName, uint8_t commandNameMaxSize);
+  uint8_t _step(uint16_t maxBytes);
+  bool stepSegment(uint8_t **buffer, uint16_t *size);
+  void stepComplete(bool success);
+  _BC_ASYNC_TRANSACTION async;
+#endif
   void bytecpy(uint8_t *dst, uint8_t *src, uint16_t size);
   void lockTake(void);
   void lockRelease(void);
+#ifndef BERGCLOUD_LOCK_NONE
+  uint32_t lockClock_uS(void);
+  BERGCloudLockStats lockStats;
+  uint32_t lockTaken_uS;
+#endif
+#ifdef BERGCLOUD_LOCK_PTHREAD
+  pthread_mutex_t lock;
+#endif
+#ifdef BERGCLOUD_LOCK_USER
+  void *lockContext;
+#endif
   bool synced;
+  uint8_t lastStatus;
+  /* Not copyable; each instance owns its shield and lock */
+  BERGCloudBase(const BERGCloudBase&);
+  BERGCloudBase& operator=(const BERGCloudBase&);
+  /* Records another backend by calling its SPI and timer hooks */
+  friend class BERGCloudTraceRecorder;
 };
 
 #endif // #ifndef BERGCLOUDBASE_H
@@ -0,0 +1,483 @@
+/*
+
+BERGCloud byte swapping for bulk array pack/unpack
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memcpy() */
+
+#include "BERGCloudByteSwap.h"
+
+#ifdef BERGCLOUD_BYTESWAP_HAVE_SSSE3
+#include <immintrin.h>
+#endif
+
+#ifdef BERGCLOUD_BYTESWAP_HAVE_NEON
+#include <arm_neon.h>
+#endif
+
+void byteswap_pack_unrolled(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type)
+{
+  uint16_t i;
+
+  if (width == sizeof(uint8_t))
+  {
+    const uint8_t *v = (const uint8_t *)values;
+
+    for (i=0; i<count; i++)
+    {
+      out[0] = type;
+      out[1] = v[i];
+      out += 2;
+    }
+  }
+  else if (width == sizeof(uint16_t))
+  {
+    const uint16_t *v = (const uint16_t *)values;
+
+    for (i=0; i<count; i++)
+    {
+      out[0] = type;
+      out[1] = (uint8_t)(v[i] >> 8);
+      out[2] = (uint8_t)v[i];
+      out += 3;
+    }
+  }
+  else if (width == sizeof(uint32_t))
+  {
+    const uint8_t *v = (const uint8_t *)values;
+    uint32_t data;
+
+    for (i=0; i<count; i++)
+    {
+      /* memcpy() as the values may be floats */
+      memcpy(&data, v, sizeof(uint32_t));
+      out[0] = type;
+      out[1] = (uint8_t)(data >> 24);
+      out[2] = (uint8_t)(data >> 16);
+      out[3] = (uint8_t)(data >> 8);
+      out[4] = (uint8_t)data;
+      out += 5;
+      v += sizeof(uint32_t);
+    }
+  }
+  else if (width == sizeof(uint64_t))
+  {
+    const uint8_t *v = (const uint8_t *)values;
+    uint64_t data;
+    uint32_t high;
+    uint32_t low;
+
+    for (i=0; i<count; i++)
+    {
+      memcpy(&data, v, sizeof(uint64_t));
+      high = (uint32_t)(data >> 32);
+      low = (uint32_t)data;
+      out[0] = type;
+      out[1] = (uint8_t)(high >> 24);
+      out[2] = (uint8_t)(high >> 16);
+      out[3] = (uint8_t)(high >> 8);
+      out[4] = (uint8_t)high;
+      out[5] = (uint8_t)(low >> 24);
+      out[6] = (uint8_t)(low >> 16);
+      out[7] = (uint8_t)(low >> 8);
+      out[8] = (uint8_t)low;
+      out += 9;
+      v += sizeof(uint64_t);
+    }
+  }
+}
+
+bool byteswap_unpack_unrolled(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type)
+{
+  uint16_t i;
+
+  if (width == sizeof(uint8_t))
+  {
+    uint8_t *v = (uint8_t *)values;
+
+    for (i=0; i<count; i++)
+    {
+      if (in[0] != type)
+      {
+        return false;
+      }
+
+      v[i] = in[1];
+      in += 2;
+    }
+  }
+  else if (width == sizeof(uint16_t))
+  {
+    uint16_t *v = (uint16_t *)values;
+
+    for (i=0; i<count; i++)
+    {
+      if (in[0] != type)
+      {
+        return false;
+      }
+
+      v[i] = ((uint16_t)in[1] << 8) | in[2];
+      in += 3;
+    }
+  }
+  else if (width == sizeof(uint32_t))
+  {
+    uint8_t *v = (uint8_t *)values;
+    uint32_t data;
+
+    for (i=0; i<count; i++)
+    {
+      if (in[0] != type)
+      {
+        return false;
+      }
+
+      data = ((uint32_t)in[1] << 24) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 8) | in[4];
+      memcpy(v, &data, sizeof(uint32_t));
+      in += 5;
+      v += sizeof(uint32_t);
+    }
+  }
+  else if (width == sizeof(uint64_t))
+  {
+    uint8_t *v = (uint8_t *)values;
+    uint64_t data;
+    uint32_t high;
+    uint32_t low;
+
+    for (i=0; i<count; i++)
+    {
+      if (in[0] != type)
+      {
+        return false;
+      }
+
+      high = ((uint32_t)in[1] << 24) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 8) | in[4];
+      low = ((uint32_t)in[5] << 24) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 8) | in[8];
+      data = ((uint64_t)high << 32) | low;
+      memcpy(v, &data, sizeof(uint64_t));
+      in += 9;
+      v += sizeof(uint64_t);
+    }
+  }
+
+  return true;
+}
+
+#if defined(BERGCLOUD_BYTESWAP_HAVE_SSSE3) || defined(BERGCLOUD_BYTESWAP_HAVE_NEON)
+
+/*
+ * Shuffles for a little-endian host, one row per width of 1, 2, 4 and 8
+ * bytes. Each 16-byte shuffle handles 'items' items; 0x80 gives a zero
+ * byte. Positions past the last item are stored but overwritten by the
+ * next shuffle, so the vector loops stop while 'minItems' items remain
+ * and leave those to the unrolled versions.
+ */
+
+struct _BC_BYTESWAP_SHUFFLE {
+  uint8_t items;
+  uint8_t minItems;
+  uint8_t inSize;   /* Bytes loaded, 8 or 16 */
+  uint8_t outSize;  /* Bytes stored, 8 or 16 */
+  uint8_t index[16];
+  uint8_t typeMask[16];
+};
+
+/* Values to items; the type byte is ORed in where typeMask is set */
+static const _BC_BYTESWAP_SHUFFLE packShuffle[4] = {
+  { 8, 8, 8, 16,
+    { 0x80, 0, 0x80, 1, 0x80, 2, 0x80, 3, 0x80, 4, 0x80, 5, 0x80, 6, 0x80, 7 },
+    { 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0 } },
+  { 4, 6, 8, 16,
+    { 0x80, 1, 0, 0x80, 3, 2, 0x80, 5, 4, 0x80, 7, 6, 0x80, 0x80, 0x80, 0x80 },
+    { 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0, 0, 0, 0 } },
+  { 3, 4, 16, 16,
+    { 0x80, 3, 2, 1, 0, 0x80, 7, 6, 5, 4, 0x80, 11, 10, 9, 8, 0x80 },
+    { 0xff, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0 } },
+  { 1, 2, 8, 16,
+    { 0x80, 7, 6, 5, 4, 3, 2, 1, 0, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    { 0xff, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } }
+};
+
+/* Items to values; the type bytes must match where typeMask is set */
+static const _BC_BYTESWAP_SHUFFLE unpackShuffle[4] = {
+  { 8, 8, 16, 8,
+    { 1, 3, 5, 7, 9, 11, 13, 15, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    { 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0, 0xff, 0 } },
+  { 4, 6, 16, 8,
+    { 2, 1, 5, 4, 8, 7, 11, 10, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    { 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0xff, 0, 0, 0, 0, 0, 0 } },
+  { 3, 4, 16, 16,
+    { 4, 3, 2, 1, 9, 8, 7, 6, 14, 13, 12, 11, 0x80, 0x80, 0x80, 0x80 },
+    { 0xff, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0xff, 0, 0, 0, 0, 0 } },
+  { 1, 2, 16, 8,
+    { 8, 7, 6, 5, 4, 3, 2, 1, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80 },
+    { 0xff, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } }
+};
+
+static const _BC_BYTESWAP_SHUFFLE *byteswap_shuffle(const _BC_BYTESWAP_SHUFFLE *table, uint8_t width)
+{
+  switch (width)
+  {
+  case 1:
+    return &table[0];
+  case 2:
+    return &table[1];
+  case 4:
+    return &table[2];
+  case 8:
+    return &table[3];
+  default:
+    return NULL;
+  }
+}
+
+#endif // #if defined(BERGCLOUD_BYTESWAP_HAVE_SSSE3) || defined(BERGCLOUD_BYTESWAP_HAVE_NEON)
+
+#ifdef BERGCLOUD_BYTESWAP_HAVE_SSSE3
+
+static bool byteswap_ssse3_supported(void)
+{
+  static const bool supported = __builtin_cpu_supports("ssse3");
+
+  return supported;
+}
+
+__attribute__((target("ssse3")))
+static uint16_t byteswap_pack_shuffle(uint8_t *out, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type)
+{
+  /* Returns the number of items packed */
+  const _BC_BYTESWAP_SHUFFLE *s = byteswap_shuffle(packShuffle, width);
+  const __m128i index = _mm_loadu_si128((const __m128i *)s->index);
+  const __m128i types = _mm_and_si128(_mm_loadu_si128((const __m128i *)s->typeMask), _mm_set1_epi8((char)type));
+  __m128i block;
+  uint16_t i = 0;
+
+  while ((count - i) >= s->minItems)
+  {
+    if (s->inSize == 8)
+    {
+      block = _mm_loadl_epi64((const __m128i *)in);
+    }
+    else
+    {
+      block = _mm_loadu_si128((const __m128i *)in);
+    }
+
+    block = _mm_or_si128(_mm_shuffle_epi8(block, index), types);
+    _mm_storeu_si128((__m128i *)out, block);
+
+    in += s->items * width;
+    out += s->items * (width + 1);
+    i += s->items;
+  }
+
+  return i;
+}
+
+__attribute__((target("ssse3")))
+static uint16_t byteswap_unpack_shuffle(uint8_t *out, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type, bool *match)
+{
+  /* Returns the number of items unpacked; 'match' is cleared if a */
+  /* type byte is wrong */
+  const _BC_BYTESWAP_SHUFFLE *s = byteswap_shuffle(unpackShuffle, width);
+  const __m128i index = _mm_loadu_si128((const __m128i *)s->index);
+  const __m128i typeMask = _mm_loadu_si128((const __m128i *)s->typeMask);
+  const __m128i types = _mm_and_si128(typeMask, _mm_set1_epi8((char)type));
+  __m128i block;
+  uint16_t i = 0;
+
+  while ((count - i) >= s->minItems)
+  {
+    block = _mm_loadu_si128((const __m128i *)in);
+
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(block, typeMask), types)) != 0xffff)
+    {
+      *match = false;
+      return i;
+    }
+
+    block = _mm_shuffle_epi8(block, index);
+
+    if (s->outSize == 8)
+    {
+      _mm_storel_epi64((__m128i *)out, block);
+    }
+    else
+    {
+      _mm_storeu_si128((__m128i *)out, block);
+    }
+
+    in += s->items * (width + 1);
+    out += s->items * width;
+    i += s->items;
+  }
+
+  return i;
+}
+
+void byteswap_pack_ssse3(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type)
+{
+  uint16_t done = 0;
+
+  if (byteswap_ssse3_supported() && (byteswap_shuffle(packShuffle, width) != NULL))
+  {
+    done = byteswap_pack_shuffle(out, (const uint8_t *)values, count, width, type);
+  }
+
+  byteswap_pack_unrolled(out + (done * (width + 1)), (const uint8_t *)values + (done * width),
+    count - done, width, type);
+}
+
+bool byteswap_unpack_ssse3(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type)
+{
+  uint16_t done = 0;
+  bool match = true;
+
+  if (byteswap_ssse3_supported() && (byteswap_shuffle(unpackShuffle, width) != NULL))
+  {
+    done = byteswap_unpack_shuffle((uint8_t *)values, in, count, width, type, &match);
+  }
+
+  if (!match)
+  {
+    return false;
+  }
+
+  return byteswap_unpack_unrolled((uint8_t *)values + (done * width), in + (done * (width + 1)),
+    count - done, width, type);
+}
+
+#endif // #ifdef BERGCLOUD_BYTESWAP_HAVE_SSSE3
+
+#ifdef BERGCLOUD_BYTESWAP_HAVE_NEON
+
+void byteswap_pack_neon(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type)
+{
+  const _BC_BYTESWAP_SHUFFLE *s = byteswap_shuffle(packShuffle, width);
+  const uint8_t *in = (const uint8_t *)values;
+  uint8x16_t index;
+  uint8x16_t types;
+  uint8x16_t block;
+  uint16_t i = 0;
+
+  if (s != NULL)
+  {
+    index = vld1q_u8(s->index);
+    types = vandq_u8(vld1q_u8(s->typeMask), vdupq_n_u8(type));
+
+    while ((count - i) >= s->minItems)
+    {
+      if (s->inSize == 8)
+      {
+        block = vcombine_u8(vld1_u8(in), vdup_n_u8(0));
+      }
+      else
+      {
+        block = vld1q_u8(in);
+      }
+
+      vst1q_u8(out, vorrq_u8(vqtbl1q_u8(block, index), types));
+
+      in += s->items * width;
+      out += s->items * (width + 1);
+      i += s->items;
+    }
+  }
+
+  byteswap_pack_unrolled(out, in, count - i, width, type);
+}
+
+bool byteswap_unpack_neon(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type)
+{
+  const _BC_BYTESWAP_SHUFFLE *s = byteswap_shuffle(unpackShuffle, width);
+  uint8_t *out = (uint8_t *)values;
+  uint8x16_t index;
+  uint8x16_t typeMask;
+  uint8x16_t types;
+  uint8x16_t block;
+  uint16_t i = 0;
+
+  if (s != NULL)
+  {
+    index = vld1q_u8(s->index);
+    typeMask = vld1q_u8(s->typeMask);
+    types = vandq_u8(typeMask, vdupq_n_u8(type));
+
+    while ((count - i) >= s->minItems)
+    {
+      block = vld1q_u8(in);
+
+      if (vminvq_u8(vceqq_u8(vandq_u8(block, typeMask), types)) != 0xff)
+      {
+        return false;
+      }
+
+      block = vqtbl1q_u8(block, index);
+
+      if (s->outSize == 8)
+      {
+        vst1_u8(out, vget_low_u8(block));
+      }
+      else
+      {
+        vst1q_u8(out, block);
+      }
+
+      in += s->items * (width + 1);
+      out += s->items * width;
+      i += s->items;
+    }
+  }
+
+  return byteswap_unpack_unrolled(out, in, count - i, width, type);
+}
+
+#endif // #ifdef BERGCLOUD_BYTESWAP_HAVE_NEON
+
+void byteswap_pack(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type)
+{
+#if defined(BERGCLOUD_BYTESWAP_HAVE_SSSE3)
+  byteswap_pack_ssse3(out, values, count, width, type);
+#elif defined(BERGCLOUD_BYTESWAP_HAVE_NEON)
+  byteswap_pack_neon(out, values, count, width, type);
+#else
+  byteswap_pack_unrolled(out, values, count, width, type);
+#endif
+}
+
+bool byteswap_unpack(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type)
+{
+#if defined(BERGCLOUD_BYTESWAP_HAVE_SSSE3)
+  return byteswap_unpack_ssse3(values, in, count, width, type);
+#elif defined(BERGCLOUD_BYTESWAP_HAVE_NEON)
+  return byteswap_unpack_neon(values, in, count, width, type);
+#else
+  return byteswap_unpack_unrolled(values, in, count, width, type);
+#endif
+}
@@ -0,0 +1,66 @@
+/*
+
+BERGCloud byte swapping for bulk array pack/unpack
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDBYTESWAP_H
+#define BERGCLOUDBYTESWAP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudConfig.h"
+
+/*
+ * Fixed-width MessagePack items: each value of 'width' bytes (1, 2, 4
+ * or 8) is written as the byte 'type' followed by the value, most
+ * significant byte first, so 'count' items use count * (width + 1)
+ * bytes. All of the implementations below give the same result;
+ * byteswap_pack() and byteswap_unpack() use the fastest one available.
+ */
+
+/* Write 'count' items from the host order values at 'values' */
+void byteswap_pack(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type);
+/* Read 'count' items into 'values', returns false if any item does */
+/* not have the type byte 'type'; 'values' may then be partly written */
+bool byteswap_unpack(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type);
+
+/* Shifts, one item at a time */
+void byteswap_pack_unrolled(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type);
+bool byteswap_unpack_unrolled(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type);
+
+#ifdef BERGCLOUD_BYTESWAP_HAVE_SSSE3
+/* SSSE3 byte shuffles; fall back to the unrolled versions if the CPU */
+/* does not support SSSE3 */
+void byteswap_pack_ssse3(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type);
+bool byteswap_unpack_ssse3(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type);
+#endif
+
+#ifdef BERGCLOUD_BYTESWAP_HAVE_NEON
+/* NEON table lookups */
+void byteswap_pack_neon(uint8_t *out, const void *values, uint16_t count, uint8_t width, uint8_t type);
+bool byteswap_unpack_neon(void *values, const uint8_t *in, uint16_t count, uint8_t width, uint8_t type);
+#endif
+
+#endif // #ifndef BERGCLOUDBYTESWAP_H
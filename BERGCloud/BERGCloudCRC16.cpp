@@ -0,0 +1,255 @@
+/*
+
+BERGCloud CRC16 CCITT
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudCRC16.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define _CRC16_TABLE_READ(i) pgm_read_word(&crc16Table[(i)])
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#define _CRC16_TABLE_READ(i) crc16Table[(i)]
+#endif
+
+#ifdef BERGCLOUD_CRC16_HAVE_PCLMUL
+#include <immintrin.h>
+#endif
+
+/* CRC of each byte value with a zero seed */
+static const uint16_t crc16Table[256] PROGMEM = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+  0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
+  0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6,
+  0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de,
+  0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7, 0x44a4, 0x5485,
+  0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf, 0xc5ac, 0xd58d,
+  0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6, 0x5695, 0x46b4,
+  0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d, 0xc7bc,
+  0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+  0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b,
+  0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12,
+  0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a,
+  0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41,
+  0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b, 0x8d68, 0x9d49,
+  0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32, 0x1e51, 0x0e70,
+  0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a, 0x9f59, 0x8f78,
+  0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e, 0xe16f,
+  0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+  0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e,
+  0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256,
+  0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d,
+  0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
+  0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e, 0xc71d, 0xd73c,
+  0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676, 0x4615, 0x5634,
+  0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9, 0xb98a, 0xa9ab,
+  0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882, 0x28a3,
+  0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+  0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92,
+  0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9,
+  0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1,
+  0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8,
+  0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+};
+
+uint16_t crc16_bitwise(const uint8_t *data, size_t size, uint16_t seed)
+{
+  uint8_t s;
+  uint16_t t;
+  uint16_t crc = seed;
+
+  while (size-- > 0)
+  {
+    s = *data++ ^ (crc >> 8);
+    t = s ^ (s >> 4);
+    crc = (crc << 8) ^ t ^ (t << 5) ^ (t << 12);
+  }
+
+  return crc;
+}
+
+uint16_t crc16_table(const uint8_t *data, size_t size, uint16_t seed)
+{
+  uint16_t crc = seed;
+
+  while (size-- > 0)
+  {
+    crc = (crc << 8) ^ _CRC16_TABLE_READ((uint8_t)((crc >> 8) ^ *data++));
+  }
+
+  return crc;
+}
+
+#ifndef __AVR__
+
+/* Slice tables: entry [k][b] is the CRC of byte b followed by */
+/* k zero bytes. Built on first use. */
+class Crc16SliceTables
+{
+public:
+  Crc16SliceTables(void)
+  {
+    uint16_t b;
+    uint8_t k;
+
+    for (b=0; b<256; b++)
+    {
+      t[0][b] = crc16Table[b];
+    }
+
+    for (k=1; k<8; k++)
+    {
+      for (b=0; b<256; b++)
+      {
+        t[k][b] = (t[k-1][b] << 8) ^ t[0][t[k-1][b] >> 8];
+      }
+    }
+  }
+
+  uint16_t t[8][256];
+};
+
+static const Crc16SliceTables& crc16SliceTables(void)
+{
+  /* Function-local static; initialisation is thread-safe */
+  static const Crc16SliceTables tables;
+  return tables;
+}
+
+uint16_t crc16_slice4(const uint8_t *data, size_t size, uint16_t seed)
+{
+  const Crc16SliceTables& tables = crc16SliceTables();
+  uint16_t crc = seed;
+
+  while (size >= 4)
+  {
+    crc ^= ((uint16_t)data[0] << 8) | data[1];
+    crc = tables.t[3][crc >> 8] ^ tables.t[2][crc & 0xff] ^
+          tables.t[1][data[2]] ^ tables.t[0][data[3]];
+    data += 4;
+    size -= 4;
+  }
+
+  return crc16_table(data, size, crc);
+}
+
+uint16_t crc16_slice8(const uint8_t *data, size_t size, uint16_t seed)
+{
+  const Crc16SliceTables& tables = crc16SliceTables();
+  uint16_t crc = seed;
+
+  while (size >= 8)
+  {
+    crc ^= ((uint16_t)data[0] << 8) | data[1];
+    crc = tables.t[7][crc >> 8] ^ tables.t[6][crc & 0xff] ^
+          tables.t[5][data[2]] ^ tables.t[4][data[3]] ^
+          tables.t[3][data[4]] ^ tables.t[2][data[5]] ^
+          tables.t[1][data[6]] ^ tables.t[0][data[7]];
+    data += 8;
+    size -= 8;
+  }
+
+  return crc16_table(data, size, crc);
+}
+
+#endif // #ifndef __AVR__
+
+#ifdef BERGCLOUD_CRC16_HAVE_PCLMUL
+
+/* Folding constants, x^192 mod P and x^128 mod P */
+#define _CRC16_K192 0x650b
+#define _CRC16_K128 0xaefc
+
+/* Below this size the fold setup costs more than it saves */
+#define _CRC16_PCLMUL_MIN_SIZE 32
+
+__attribute__((target("pclmul,ssse3")))
+static uint16_t crc16_fold(const uint8_t *data, size_t size, uint16_t seed)
+{
+  /* The message is treated as a polynomial, first byte most significant. */
+  /* 128-bit blocks are folded into an accumulator that is congruent to */
+  /* the message so far modulo P; the CRC of the accumulator followed by */
+  /* the remaining bytes is the CRC of the whole message. */
+  const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  const __m128i k = _mm_set_epi64x(_CRC16_K192, _CRC16_K128);
+  __m128i acc;
+  __m128i block;
+  uint8_t folded[16];
+
+  /* Load the first block and apply the seed to its first two bytes */
+  acc = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), reverse);
+  acc = _mm_xor_si128(acc, _mm_set_epi64x((int64_t)((uint64_t)seed << 48), 0));
+  data += 16;
+  size -= 16;
+
+  while (size >= 16)
+  {
+    block = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)data), reverse);
+    block = _mm_xor_si128(block, _mm_clmulepi64_si128(acc, k, 0x11)); /* High 64 bits * x^192 */
+    acc = _mm_xor_si128(block, _mm_clmulepi64_si128(acc, k, 0x00));   /* Low 64 bits * x^128 */
+    data += 16;
+    size -= 16;
+  }
+
+  /* Reduce the accumulator, then the tail */
+  _mm_storeu_si128((__m128i *)folded, _mm_shuffle_epi8(acc, reverse));
+
+  return crc16_slice8(data, size, crc16_slice8(folded, sizeof(folded), 0));
+}
+
+uint16_t crc16_pclmul(const uint8_t *data, size_t size, uint16_t seed)
+{
+  static const bool supported = __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("ssse3");
+
+  if (!supported || (size < _CRC16_PCLMUL_MIN_SIZE))
+  {
+    return crc16_slice8(data, size, seed);
+  }
+
+  return crc16_fold(data, size, seed);
+}
+
+#endif // #ifdef BERGCLOUD_CRC16_HAVE_PCLMUL
+
+uint16_t crc16(const uint8_t *data, size_t size, uint16_t seed)
+{
+#if defined(BERGCLOUD_CRC16_PCLMUL) && defined(BERGCLOUD_CRC16_HAVE_PCLMUL)
+  return crc16_pclmul(data, size, seed);
+#elif (defined(BERGCLOUD_CRC16_SLICE8) || defined(BERGCLOUD_CRC16_PCLMUL)) && !defined(__AVR__)
+  return crc16_slice8(data, size, seed);
+#elif defined(BERGCLOUD_CRC16_SLICE4) && !defined(__AVR__)
+  return crc16_slice4(data, size, seed);
+#elif defined(BERGCLOUD_CRC16_BITWISE)
+  return crc16_bitwise(data, size, seed);
+#else
+  return crc16_table(data, size, seed);
+#endif
+}
@@ -0,0 +1,61 @@
+/*
+
+BERGCloud CRC16 CCITT
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDCRC16_H
+#define BERGCLOUDCRC16_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudConfig.h"
+
+/*
+ * CRC16 CCITT (polynomial 0x1021, MSB first, no final XOR) as used by
+ * the SPI protocol. All of the implementations below give the same
+ * result; crc16() uses the one selected in BERGCloudConfig.h.
+ */
+
+/* Calculate the CRC of a buffer, starting from 'seed' */
+uint16_t crc16(const uint8_t *data, size_t size, uint16_t seed);
+
+/* Shift/XOR, one byte at a time */
+uint16_t crc16_bitwise(const uint8_t *data, size_t size, uint16_t seed);
+/* 256-entry lookup table; the table is in PROGMEM on AVR */
+uint16_t crc16_table(const uint8_t *data, size_t size, uint16_t seed);
+
+#ifndef __AVR__
+/* Slice-by-4 and slice-by-8 lookup tables */
+uint16_t crc16_slice4(const uint8_t *data, size_t size, uint16_t seed);
+uint16_t crc16_slice8(const uint8_t *data, size_t size, uint16_t seed);
+#endif
+
+#ifdef BERGCLOUD_CRC16_HAVE_PCLMUL
+/* Carry-less multiply folding; falls back to crc16_slice8() */
+/* if the CPU does not support PCLMULQDQ and SSSE3 */
+uint16_t crc16_pclmul(const uint8_t *data, size_t size, uint16_t seed);
+#endif
+
+#endif // #ifndef BERGCLOUDCRC16_H
@@ -0,0 +1,223 @@
+/*
+
+BERGCloud command queue
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudCommandQueue.h"
+
+BERGCloudCommandQueue::BERGCloudCommandQueue(BERGCloudBase& bergcloud)
+{
+  this->bergcloud = &bergcloud;
+  head = 0;
+  used = 0;
+  count = 0;
+  clearStats();
+}
+
+bool BERGCloudCommandQueue::prefetch(uint32_t budget_mS)
+{
+  /* Returns TRUE if the shield had no more commands or the queue */
+  /* is full or the time budget was used */
+
+  uint8_t commandBuffer[SPI_MAX_PAYLOAD_SIZE_BYTES];
+  uint16_t commandSize;
+  const char *commandName;
+  const uint8_t *commandData;
+  uint8_t nameSize;
+  uint16_t i;
+  _BC_TIMER timer;
+  bool result = true;
+
+  bergcloud->timerStart(&timer);
+  lastDrainCount = 0;
+
+  /* Only poll when any command will fit, as polling removes it */
+  /* from the shield */
+  while (((BC_COMMAND_QUEUE_SIZE_BYTES - used) >= _BC_COMMAND_ENTRY_MAX_SIZE) && (count < UINT8_MAX))
+  {
+    /* Unnamed commands are kept too, as polling has taken them */
+    if (!bergcloud->pollForCommand(commandBuffer, sizeof(commandBuffer), commandSize, commandName, nameSize))
+    {
+      if ((bergcloud->getLastStatus() != BC_TRANSACTION_DONE) || (bergcloud->getLastResponse() != SPI_RSP_NO_DATA))
+      {
+        _LOG("Poll failed (BERGCloudCommandQueue::prefetch)\r\n");
+        result = false;
+      }
+      break;
+    }
+
+    /* Store the command */
+    commandData = (const uint8_t *)commandName + nameSize;
+    put(nameSize);
+    put(commandSize);
+
+    for (i=0; i<nameSize; i++)
+    {
+      put(commandName[i]);
+    }
+
+    for (i=0; i<commandSize; i++)
+    {
+      put(commandData[i]);
+    }
+
+    count++;
+    commandsFetched++;
+    lastDrainCount++;
+
+    if (bergcloud->timerElapsed_mS(&timer) >= budget_mS)
+    {
+      break;
+    }
+  }
+
+  lastDrain_mS = bergcloud->timerElapsed_mS(&timer);
+
+  if (lastDrain_mS > maxDrain_mS)
+  {
+    maxDrain_mS = lastDrain_mS;
+  }
+
+  return result;
+}
+
+bool BERGCloudCommandQueue::dequeue(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize)
+{
+  /* Returns TRUE if a command was taken from the queue */
+
+  uint8_t nameSize;
+  uint8_t dataSize;
+  uint16_t i;
+  bool result;
+
+  if ((commandName == NULL) || (commandNameMaxSize < 2))
+  {
+    return false;
+  }
+
+  *commandName = '\0';
+  commandSize = 0;
+
+  if (count == 0)
+  {
+    return false;
+  }
+
+  nameSize = get();
+  dataSize = get();
+
+  /* Truncate the name as pollForCommand() does */
+  for (i=0; i<nameSize; i++)
+  {
+    if (i < (commandNameMaxSize - 1)) /* -1 for null terminator */
+    {
+      commandName[i] = get();
+      commandName[i + 1] = '\0';
+    }
+    else
+    {
+      get();
+    }
+  }
+
+  result = (dataSize <= commandBufferSize);
+
+  for (i=0; i<dataSize; i++)
+  {
+    if (result)
+    {
+      commandBuffer[i] = get();
+    }
+    else
+    {
+      get();
+    }
+  }
+
+  count--;
+
+  if (!result)
+  {
+    _LOG("Buffer too small, command dropped (BERGCloudCommandQueue::dequeue)\r\n");
+    *commandName = '\0';
+    commandsDropped++;
+    return false;
+  }
+
+  commandSize = dataSize;
+  return true;
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudCommandQueue::dequeue(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize)
+{
+  uint16_t dataSize;
+  bool result;
+
+  buffer.clear();
+  result = dequeue(buffer.ptr(), buffer.size(), dataSize, commandName, commandNameMaxSize);
+  buffer.used(dataSize);
+
+  return result;
+}
+#endif
+
+uint8_t BERGCloudCommandQueue::commandsQueued(void)
+{
+  return count;
+}
+
+uint16_t BERGCloudCommandQueue::bytesQueued(void)
+{
+  return used;
+}
+
+void BERGCloudCommandQueue::clearStats(void)
+{
+  commandsFetched = 0;
+  commandsDropped = 0;
+  lastDrain_mS = 0;
+  lastDrainCount = 0;
+  maxDrain_mS = 0;
+}
+
+void BERGCloudCommandQueue::put(uint8_t data)
+{
+  ring[(head + used) % BC_COMMAND_QUEUE_SIZE_BYTES] = data;
+  used++;
+}
+
+uint8_t BERGCloudCommandQueue::get(void)
+{
+  uint8_t data = ring[head];
+
+  head = (head + 1) % BC_COMMAND_QUEUE_SIZE_BYTES;
+  used--;
+  return data;
+}
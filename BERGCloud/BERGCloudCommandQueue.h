@@ -0,0 +1,78 @@
+/*
+
+BERGCloud command queue
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDCOMMANDQUEUE_H
+#define BERGCLOUDCOMMANDQUEUE_H
+
+#include "BERGCloudBase.h"
+
+/* Drains commands from the shield into a ring buffer so a burst */
+/* can be handled without waiting for one pollForCommand() per loop(). */
+/* Each command is stored as a name size byte, a data size byte, the */
+/* name (not null-terminated) and the packed data. Commands without a */
+/* name are stored with a name size of 0 and dequeued with an empty */
+/* name. */
+
+/* Largest stored command: the command ID is not stored, the two size */
+/* bytes are; an unnamed command has no messagePack fixraw byte */
+#define _BC_COMMAND_ENTRY_MAX_SIZE (2 + (SPI_MAX_PAYLOAD_SIZE_BYTES - 2))
+
+class BERGCloudCommandQueue
+{
+public:
+  BERGCloudCommandQueue(BERGCloudBase& bergcloud);
+  /* Poll for commands until the shield has none, the queue is full */
+  /* or budget_mS has passed; returns FALSE on an error */
+  bool prefetch(uint32_t budget_mS = BC_COMMAND_PREFETCH_BUDGET_MS);
+  /* Take the oldest command from the queue, without any SPI traffic */
+  bool dequeue(uint8_t *commandBuffer, uint16_t commandBufferSize, uint16_t& commandSize, char *commandName, uint8_t commandNameMaxSize);
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool dequeue(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize);
+#endif
+  /* Queue depth */
+  uint8_t commandsQueued(void);
+  uint16_t bytesQueued(void);
+  /* Statistics */
+  uint32_t commandsFetched;
+  /* Commands dropped by dequeue() as the buffer provided was too small */
+  uint32_t commandsDropped;
+  /* Time taken and commands fetched by the last prefetch() */
+  uint32_t lastDrain_mS;
+  uint8_t lastDrainCount;
+  /* Longest prefetch() */
+  uint32_t maxDrain_mS;
+  void clearStats(void);
+private:
+  void put(uint8_t data);
+  uint8_t get(void);
+  BERGCloudBase *bergcloud;
+  uint16_t head;
+  uint16_t used;
+  uint8_t count;
+  uint8_t ring[BC_COMMAND_QUEUE_SIZE_BYTES];
+};
+
+#endif // #ifndef BERGCLOUDCOMMANDQUEUE_H
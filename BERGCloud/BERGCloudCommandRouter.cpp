@@ -0,0 +1,339 @@
+/*
+
+BERGCloud command router
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For strlen() */
+
+#ifdef __AVR__
+#include <avr/pgmspace.h> /* For memcmp_P() */
+#endif
+
+#include "BERGCloudCommandRouter.h"
+
+#ifdef BERGCLOUD_PACK_UNPACK
+
+/* Longest command name, see BERGCloudBase::getCommandName() */
+#define _MAX_COMMAND_NAME_SIZE 31
+
+BERGCloudCommandRouter::BERGCloudCommandRouter(BERGCloudBase& bergcloud)
+{
+  this->bergcloud = &bergcloud;
+  unknownHandler = NULL;
+  count = 0;
+  clearStats();
+}
+
+bool BERGCloudCommandRouter::add(const char *commandName, BERGCloudCommandHandler handler)
+{
+  /* Returns TRUE if the route was added */
+
+  if (commandName == NULL)
+  {
+    return false;
+  }
+
+  return addRoute(commandName, strlen(commandName), false, handler);
+}
+
+#ifdef ARDUINO
+bool BERGCloudCommandRouter::add(const __FlashStringHelper *commandName, BERGCloudCommandHandler handler)
+{
+  /* Returns TRUE if the route was added */
+
+  const char *name = (const char *)commandName;
+
+  if (name == NULL)
+  {
+    return false;
+  }
+
+#ifdef __AVR__
+  return addRoute(name, strlen_P(name), true, handler);
+#else
+  return addRoute(name, strlen(name), true, handler);
+#endif
+}
+#endif
+
+bool BERGCloudCommandRouter::addRoute(const char *commandName, size_t commandNameSize, bool inFlash, BERGCloudCommandHandler handler)
+{
+  /* Returns TRUE if the route was added */
+
+  const char *name = commandName;
+  int16_t index;
+  int16_t i;
+  bool found;
+#ifdef __AVR__
+  char flashName[_MAX_COMMAND_NAME_SIZE];
+#endif
+
+  if (handler == NULL)
+  {
+    return false;
+  }
+
+  if ((commandNameSize == 0) || (commandNameSize > _MAX_COMMAND_NAME_SIZE))
+  {
+    _LOG("Invalid name (BERGCloudCommandRouter::add)\r\n");
+    return false;
+  }
+
+  if (count >= BC_COMMAND_ROUTER_MAX_ROUTES)
+  {
+    _LOG("Too many routes (BERGCloudCommandRouter::add)\r\n");
+    return false;
+  }
+
+#ifdef __AVR__
+  if (inFlash)
+  {
+    /* find() compares with a name in RAM */
+    memcpy_P(flashName, commandName, commandNameSize);
+    name = flashName;
+  }
+#endif
+
+  index = find(name, commandNameSize, &found);
+
+  if (found)
+  {
+    _LOG("Name already added (BERGCloudCommandRouter::add)\r\n");
+    return false;
+  }
+
+  /* Insert in order */
+  for (i=count; i>index; i--)
+  {
+    route[i] = route[i - 1];
+  }
+
+  route[index].name = commandName;
+  route[index].nameSize = commandNameSize | (inFlash ? _BC_COMMAND_ROUTE_FLASH : 0);
+  route[index].handler = handler;
+  memset(&route[index].stats, 0x00, sizeof(route[index].stats));
+  count++;
+
+  return true;
+}
+
+void BERGCloudCommandRouter::setUnknownHandler(BERGCloudUnknownCommandHandler handler)
+{
+  unknownHandler = handler;
+}
+
+bool BERGCloudCommandRouter::poll(BERGCloudMessageBuffer& buffer)
+{
+  /* Returns TRUE if a command was received */
+
+  const char *commandName;
+  uint8_t commandNameSize;
+
+  if (!bergcloud->pollForCommand(buffer, commandName, commandNameSize))
+  {
+    return false;
+  }
+
+  dispatch(commandName, commandNameSize, buffer);
+  return true;
+}
+
+bool BERGCloudCommandRouter::dispatch(const char *commandName, uint8_t commandNameSize, BERGCloudMessageBuffer& buffer)
+{
+  /* Returns TRUE if the command had a handler */
+
+  _BC_COMMAND_ROUTE *r;
+  int16_t index;
+  bool found;
+  _BC_TIMER timer;
+  uint32_t time_uS;
+
+  index = find(commandName, commandNameSize, &found);
+
+  if (!found)
+  {
+    unknownCommands++;
+
+    if (unknownHandler != NULL)
+    {
+      unknownHandler(commandName, commandNameSize, buffer);
+    }
+
+    return false;
+  }
+
+  r = &route[index];
+  r->stats.calls++;
+
+  if ((r->nameSize & _BC_COMMAND_ROUTE_TIMED) == 0)
+  {
+    r->handler(buffer);
+    return true;
+  }
+
+  bergcloud->timerStart_uS(&timer);
+  r->handler(buffer);
+  time_uS = bergcloud->timerElapsed_uS(&timer);
+
+  r->stats.totalTime_uS += time_uS;
+
+  if (time_uS > r->stats.maxTime_uS)
+  {
+    r->stats.maxTime_uS = time_uS;
+  }
+
+  return true;
+}
+
+const BERGCloudCommandRouteStats *BERGCloudCommandRouter::getStats(const char *commandName)
+{
+  int16_t index;
+  bool found;
+
+  if (commandName == NULL)
+  {
+    return NULL;
+  }
+
+  index = find(commandName, strlen(commandName), &found);
+  return found ? &route[index].stats : NULL;
+}
+
+bool BERGCloudCommandRouter::setTiming(const char *commandName, bool enabled)
+{
+  /* Returns TRUE if the command has a handler */
+
+  int16_t index;
+  bool found;
+
+  if (commandName == NULL)
+  {
+    return false;
+  }
+
+  index = find(commandName, strlen(commandName), &found);
+
+  if (!found)
+  {
+    return false;
+  }
+
+  if (enabled)
+  {
+    route[index].nameSize |= _BC_COMMAND_ROUTE_TIMED;
+  }
+  else
+  {
+    route[index].nameSize &= ~_BC_COMMAND_ROUTE_TIMED;
+  }
+
+  return true;
+}
+
+void BERGCloudCommandRouter::clearStats(void)
+{
+  uint8_t i;
+
+  for (i=0; i<count; i++)
+  {
+    memset(&route[i].stats, 0x00, sizeof(route[i].stats));
+  }
+
+  unknownCommands = 0;
+}
+
+uint8_t BERGCloudCommandRouter::routes(void)
+{
+  return count;
+}
+
+int16_t BERGCloudCommandRouter::find(const char *commandName, uint8_t commandNameSize, bool *found)
+{
+  /* Binary search; returns the index of the route if found, otherwise */
+  /* the index at which it would be inserted */
+
+  int16_t low = 0;
+  int16_t high = count - 1;
+  int16_t middle;
+  int8_t result;
+
+  while (low <= high)
+  {
+    middle = (low + high) / 2;
+    result = compare(commandName, commandNameSize, &route[middle]);
+
+    if (result == 0)
+    {
+      *found = true;
+      return middle;
+    }
+
+    if (result < 0)
+    {
+      high = middle - 1;
+    }
+    else
+    {
+      low = middle + 1;
+    }
+  }
+
+  *found = false;
+  return low;
+}
+
+int8_t BERGCloudCommandRouter::compare(const char *name, uint8_t nameSize, const _BC_COMMAND_ROUTE *r)
+{
+  /* Order by size first, then by content, so that most names differ */
+  /* after comparing a single byte */
+
+  uint8_t routeNameSize = r->nameSize & _BC_COMMAND_ROUTE_SIZE;
+  int result;
+
+  if (nameSize != routeNameSize)
+  {
+    return (nameSize < routeNameSize) ? -1 : 1;
+  }
+
+#ifdef __AVR__
+  if (r->nameSize & _BC_COMMAND_ROUTE_FLASH)
+  {
+    result = memcmp_P(name, r->name, nameSize);
+  }
+  else
+  {
+    result = memcmp(name, r->name, nameSize);
+  }
+#else
+  result = memcmp(name, r->name, nameSize);
+#endif
+
+  return (result < 0) ? -1 : ((result > 0) ? 1 : 0);
+}
+
+#endif // #ifdef BERGCLOUD_PACK_UNPACK
@@ -0,0 +1,115 @@
+/*
+
+BERGCloud command router
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDCOMMANDROUTER_H
+#define BERGCLOUDCOMMANDROUTER_H
+
+#include "BERGCloudBase.h"
+
+#ifdef ARDUINO
+#include <Arduino.h> /* For __FlashStringHelper */
+#endif
+
+#ifdef BERGCLOUD_PACK_UNPACK
+
+/* Calls a handler for each command according to its name. Routes are */
+/* kept sorted by name so a command is found by binary search, using */
+/* the name where it was received rather than a copy. Names can be in */
+/* flash, so on AVR they take no RAM apart from a pointer. */
+
+/* Called with the buffer ready to unpack the command's data */
+typedef void (*BERGCloudCommandHandler)(BERGCloudMessageBuffer& buffer);
+/* Called for a command without a route; the name is not null-terminated */
+typedef void (*BERGCloudUnknownCommandHandler)(const char *commandName, uint8_t commandNameSize, BERGCloudMessageBuffer& buffer);
+
+typedef struct {
+  uint32_t calls;
+  /* Time spent in the handler; only measured for routes with timing */
+  /* enabled, see setTiming() */
+  uint32_t totalTime_uS;
+  uint32_t maxTime_uS;
+} BERGCloudCommandRouteStats;
+
+/* Set in nameSize if the name is in flash */
+#define _BC_COMMAND_ROUTE_FLASH   0x80
+/* Set in nameSize if the handler is timed */
+#define _BC_COMMAND_ROUTE_TIMED   0x40
+#define _BC_COMMAND_ROUTE_SIZE    0x3f
+
+typedef struct {
+  const char *name;
+  uint8_t nameSize;
+  BERGCloudCommandHandler handler;
+  BERGCloudCommandRouteStats stats;
+} _BC_COMMAND_ROUTE;
+
+class BERGCloudCommandRouter
+{
+public:
+  BERGCloudCommandRouter(BERGCloudBase& bergcloud);
+  /* Add a handler; the name must remain valid. Returns FALSE if the */
+  /* name already has a handler or there are too many routes. */
+  bool add(const char *commandName, BERGCloudCommandHandler handler);
+#ifdef ARDUINO
+  /* As above with a name in flash, e.g. add(F("set-led"), handler) */
+  bool add(const __FlashStringHelper *commandName, BERGCloudCommandHandler handler);
+#endif
+#if (__cplusplus >= 201103L)
+  /* As above with a name declared with BERGCLOUD_EVENT_NAME() */
+  template <size_t L>
+  bool add(const BERGCloudEventName<L>& commandName, BERGCloudCommandHandler handler)
+  {
+    return addRoute((const char *)&commandName.header[SPI_EVENT_HEADER_SIZE_BYTES + 1], L, true, handler); /* +1 for messagePack fixraw byte */
+  }
+#endif
+  void setUnknownHandler(BERGCloudUnknownCommandHandler handler);
+  /* Poll for a command and call its handler; returns TRUE if a */
+  /* command was received */
+  bool poll(BERGCloudMessageBuffer& buffer);
+  /* Call the handler for a command received some other way */
+  bool dispatch(const char *commandName, uint8_t commandNameSize, BERGCloudMessageBuffer& buffer);
+  /* Statistics for the handler of a command, or NULL if it has none */
+  const BERGCloudCommandRouteStats *getStats(const char *commandName);
+  /* Measure the time spent in the handler for a command; off by */
+  /* default. Returns FALSE if the command has no handler. */
+  bool setTiming(const char *commandName, bool enabled = true);
+  void clearStats(void);
+  uint8_t routes(void);
+  /* Commands without a route */
+  uint32_t unknownCommands;
+private:
+  bool addRoute(const char *commandName, size_t commandNameSize, bool inFlash, BERGCloudCommandHandler handler);
+  int16_t find(const char *commandName, uint8_t commandNameSize, bool *found);
+  static int8_t compare(const char *name, uint8_t nameSize, const _BC_COMMAND_ROUTE *r);
+  BERGCloudBase *bergcloud;
+  BERGCloudUnknownCommandHandler unknownHandler;
+  uint8_t count;
+  _BC_COMMAND_ROUTE route[BC_COMMAND_ROUTER_MAX_ROUTES];
+};
+
+#endif // #ifdef BERGCLOUD_PACK_UNPACK
+
+#endif // #ifndef BERGCLOUDCOMMANDROUTER_H
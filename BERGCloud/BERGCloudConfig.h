@@ -28,12 +28,161 @@ THE SOFTWARE.
 #ifndef BERGCLOUDCONFIG_H
 #define BERGCLOUDCONFIG_H
 
-/* Include debug logging */
+/* Include debug logging; define BERGCLOUD_NO_LOG to leave it out */
+#ifndef BERGCLOUD_NO_LOG
 #define BERGCLOUD_LOG
+#endif
 
 /* Include pack/unpack */
 #ifndef LINUX
 #define BERGCLOUD_PACK_UNPACK
 #endif
 
+/* Let the 8 to 32-bit integer and float unpack() methods accept */
+/* values packed in 64-bit form when they are in range. The 64-bit */
+/* and double methods themselves are only linked when they are used. */
+#ifndef __AVR__
+#define BERGCLOUD_UNPACK_NARROW_64
+#endif
+
+/* First of the 32 MessagePack ext types used for typed arrays, see */
+/* pack_typed_array(); must be a multiple of 0x20 */
+#ifndef BC_TYPED_ARRAY_EXT_TYPE
+#define BC_TYPED_ARRAY_EXT_TYPE  0x20
+#endif
+
+/* Send and receive whole frames with one SPITransaction() call */
+/* instead of one call per byte; uses SPI_MAX_PACKET_SIZE_BYTES */
+/* of stack during a transaction */
+#ifdef LINUX
+#define BERGCLOUD_BULK_TRANSFER
+#endif
+
+/* Buffers that make up the data sent and received by a transaction; */
+/* at least 2 of each. With 3 a named event is sent as its header, */
+/* name and data without copying the name. */
+#ifndef BC_TX_SEGMENTS
+#define BC_TX_SEGMENTS  3
+#endif
+#ifndef BC_RX_SEGMENTS
+#define BC_RX_SEGMENTS  2
+#endif
+
+/* Include transport statistics, getStats() etc. */
+#ifdef LINUX
+#define BERGCLOUD_STATS
+#endif
+
+/* Include non-blocking transactions, beginSendEvent() etc., and the */
+/* event outbox and round robin that use them. They add RAM to every */
+/* BERGCloud object, so on Arduino define BERGCLOUD_ASYNC here to */
+/* include them; on Linux define BERGCLOUD_NO_ASYNC to leave them out. */
+#if defined(LINUX) && !defined(BERGCLOUD_NO_ASYNC)
+#define BERGCLOUD_ASYNC
+#endif
+
+/* Locking around transactions when several threads share a shield. */
+/* Define one of BERGCLOUD_LOCK_NONE, BERGCLOUD_LOCK_PTHREAD or */
+/* BERGCLOUD_LOCK_USER to override the default for the target. With */
+/* BERGCLOUD_LOCK_USER the application provides BERGCloudLockTake() */
+/* and BERGCloudLockRelease(), see BERGCloudBase.h. */
+#if !defined(BERGCLOUD_LOCK_NONE) && !defined(BERGCLOUD_LOCK_PTHREAD) && \
+    !defined(BERGCLOUD_LOCK_USER)
+#ifdef LINUX
+#define BERGCLOUD_LOCK_PTHREAD
+#else
+#define BERGCLOUD_LOCK_NONE
+#endif
+#endif
+
+/* Default policy when polling for a response, see setPollPolicy(). */
+/* Probe bytes are sent back-to-back for the first BC_POLL_SPIN_PROBES, */
+/* then with gaps that double from BC_POLL_MIN_GAP_US up to */
+/* BC_POLL_MAX_GAP_US. */
+#ifndef BC_POLL_SPIN_PROBES
+#define BC_POLL_SPIN_PROBES    32
+#endif
+#ifndef BC_POLL_MIN_GAP_US
+#define BC_POLL_MIN_GAP_US     50
+#endif
+#ifndef BC_POLL_MAX_GAP_US
+#define BC_POLL_MAX_GAP_US     2000
+#endif
+
+/* BERGCloudEventOutbox: events held for retry, retries per event and */
+/* the range of the exponential backoff between attempts */
+#ifndef BC_OUTBOX_DEPTH
+#ifdef ARDUINO
+#define BC_OUTBOX_DEPTH           2
+#else
+#define BC_OUTBOX_DEPTH           8
+#endif
+#endif
+#ifndef BC_OUTBOX_MAX_RETRIES
+#define BC_OUTBOX_MAX_RETRIES     5
+#endif
+#ifndef BC_OUTBOX_MIN_BACKOFF_MS
+#define BC_OUTBOX_MIN_BACKOFF_MS  100
+#endif
+#ifndef BC_OUTBOX_MAX_BACKOFF_MS
+#define BC_OUTBOX_MAX_BACKOFF_MS  10000
+#endif
+
+/* BERGCloudRoundRobin: largest number of shields served */
+#ifndef BC_ROUND_ROBIN_MAX_SHIELDS
+#define BC_ROUND_ROBIN_MAX_SHIELDS  4
+#endif
+
+/* BERGCloudCommandQueue: bytes of storage for prefetched commands and */
+/* the default time spent draining the shield by prefetch() */
+#ifndef BC_COMMAND_QUEUE_SIZE_BYTES
+#ifdef ARDUINO
+#define BC_COMMAND_QUEUE_SIZE_BYTES     256
+#else
+#define BC_COMMAND_QUEUE_SIZE_BYTES     1024
+#endif
+#endif
+#ifndef BC_COMMAND_PREFETCH_BUDGET_MS
+#define BC_COMMAND_PREFETCH_BUDGET_MS   100
+#endif
+
+/* BERGCloudCommandRouter: largest number of command names handled */
+#ifndef BC_COMMAND_ROUTER_MAX_ROUTES
+#ifdef ARDUINO
+#define BC_COMMAND_ROUTER_MAX_ROUTES    32
+#else
+#define BC_COMMAND_ROUTER_MAX_ROUTES    64
+#endif
+#endif
+
+/* CRC16 implementation, see BERGCloudCRC16.h. Define one of */
+/* BERGCLOUD_CRC16_BITWISE, BERGCLOUD_CRC16_TABLE, BERGCLOUD_CRC16_SLICE4, */
+/* BERGCLOUD_CRC16_SLICE8 or BERGCLOUD_CRC16_PCLMUL to override the */
+/* default for the target */
+#if defined(LINUX) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BERGCLOUD_CRC16_HAVE_PCLMUL
+#endif
+
+#if !defined(BERGCLOUD_CRC16_BITWISE) && !defined(BERGCLOUD_CRC16_TABLE) && \
+    !defined(BERGCLOUD_CRC16_SLICE4) && !defined(BERGCLOUD_CRC16_SLICE8) && \
+    !defined(BERGCLOUD_CRC16_PCLMUL)
+#if defined(ARDUINO) || defined(__AVR__)
+#define BERGCLOUD_CRC16_TABLE
+#elif defined(BERGCLOUD_CRC16_HAVE_PCLMUL)
+#define BERGCLOUD_CRC16_PCLMUL
+#else
+#define BERGCLOUD_CRC16_SLICE8
+#endif
+#endif
+
+/* Byte swapping used by the bulk array pack_array() and unpack_array() */
+/* methods, see BERGCloudByteSwap.h */
+#if defined(LINUX) && defined(__GNUC__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#if defined(__x86_64__) || defined(__i386__)
+#define BERGCLOUD_BYTESWAP_HAVE_SSSE3
+#elif defined(__aarch64__)
+#define BERGCLOUD_BYTESWAP_HAVE_NEON
+#endif
+#endif
+
 #endif // #ifndef BERGCLOUDCONFIG_H
@@ -110,6 +110,19 @@ THE SOFTWARE.
 #define BC_DISPLAY_CLEAR               0xc0
 /* Clear the display without changing the style */
 
+/* For connectAsync() */
+#define BC_CONNECT_POLL_INTERVAL_MS    250
+
+/* For step(), connectService() and getLastStatus() */
+#define BC_TRANSACTION_IDLE            0x00
+#define BC_TRANSACTION_IN_PROGRESS     0x01
+#define BC_TRANSACTION_DONE            0x02
+#define BC_TRANSACTION_FAILED          0x03
+/* Not started as a transaction from begin...() was in progress */
+#define BC_TRANSACTION_BUSY            0x04
+
+#define BC_STEP_MAX_BYTES              16
+
 /* For SPI_CMD_SEND_EVENT_ */
 #define SPI_EVENT_HEADER_SIZE_BYTES    4
 
@@ -0,0 +1,199 @@
+/*
+
+BERGCloud event batcher
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memcpy() */
+
+#include "BERGCloudEventBatcher.h"
+#include "BERGCloudMessagePack.h"
+
+/* Longest event name sent, see BERGCloudBase::createEventHeader() */
+#define _MAX_EVENT_NAME_SIZE  (_BC_EVENT_HEADER_MAX_SIZE - (SPI_EVENT_HEADER_SIZE_BYTES + 1))
+
+BERGCloudEventBatcher::BERGCloudEventBatcher(BERGCloudBase& bergcloud, const char *eventName, uint32_t maxAge_mS)
+{
+  uint16_t nameSize = 0;
+
+  this->bergcloud = &bergcloud;
+  this->eventName = eventName;
+  this->maxAge_mS = maxAge_mS;
+
+  if (eventName != NULL)
+  {
+    nameSize = strlen(eventName);
+  }
+
+  if (nameSize > _MAX_EVENT_NAME_SIZE)
+  {
+    nameSize = _MAX_EVENT_NAME_SIZE;
+  }
+
+  /* Space for the array header and records after the event header */
+  capacity = SPI_MAX_PAYLOAD_SIZE_BYTES - (SPI_EVENT_HEADER_SIZE_BYTES + 1 + nameSize); /* +1 for messagePack fixraw byte */
+
+  used = 0;
+  records = 0;
+  clearStats();
+}
+
+bool BERGCloudEventBatcher::add(const uint8_t *record, uint16_t recordSize)
+{
+  /* The array header is one byte for up to 15 records, three bytes otherwise */
+  uint16_t headerSize = (records < (_MP_FIXARRAY_MAX - _MP_FIXARRAY_MIN)) ? 1 : _BC_BATCH_ARRAY_HEADER_SIZE;
+
+  if ((record == NULL) || (recordSize == 0))
+  {
+    return false;
+  }
+
+  if ((1 + recordSize) > capacity)
+  {
+    _LOG("Record is too big (BERGCloudEventBatcher::add)\r\n");
+    return false;
+  }
+
+  if ((headerSize + used + recordSize) > capacity)
+  {
+    /* Send the records held to make space */
+    if (!flush())
+    {
+      return false;
+    }
+  }
+
+  if (records == 0)
+  {
+    /* Oldest record */
+    bergcloud->timerStart(&age);
+  }
+
+  memcpy(&frame[_BC_BATCH_ARRAY_HEADER_SIZE + used], record, recordSize);
+  used += recordSize;
+  records++;
+
+  return true;
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudEventBatcher::add(BERGCloudMessageBuffer& record)
+{
+  return add(record.ptr(), record.used());
+}
+#endif
+
+bool BERGCloudEventBatcher::service(void)
+{
+  if ((records == 0) || (maxAge_mS == 0))
+  {
+    return true;
+  }
+
+  if (bergcloud->timerElapsed_mS(&age) < maxAge_mS)
+  {
+    return true;
+  }
+
+  return flush();
+}
+
+bool BERGCloudEventBatcher::flush(void)
+{
+  /* Send the records held; they are kept if sending fails */
+
+  uint8_t *start;
+  uint16_t size;
+
+  if (records == 0)
+  {
+    return true;
+  }
+
+  /* Write the array header immediately before the first record */
+  if (records <= (_MP_FIXARRAY_MAX - _MP_FIXARRAY_MIN))
+  {
+    start = &frame[_BC_BATCH_ARRAY_HEADER_SIZE - 1];
+    start[0] = _MP_FIXARRAY_MIN + records;
+  }
+  else
+  {
+    start = frame;
+    start[0] = _MP_ARRAY16;
+    start[1] = records >> 8;
+    start[2] = records & 0xff;
+  }
+
+  size = (&frame[_BC_BATCH_ARRAY_HEADER_SIZE] - start) + used;
+
+  if (!bergcloud->sendEvent(eventName, start, size))
+  {
+    sendFailures++;
+    return false;
+  }
+
+  framesSent++;
+  recordsSent += records;
+  bytesSent += size;
+
+  used = 0;
+  records = 0;
+  return true;
+}
+
+uint16_t BERGCloudEventBatcher::recordsHeld(void)
+{
+  return records;
+}
+
+uint16_t BERGCloudEventBatcher::recordsPerFrame(void)
+{
+  if (framesSent == 0)
+  {
+    return 0;
+  }
+
+  return recordsSent / framesSent;
+}
+
+uint16_t BERGCloudEventBatcher::bytesPerFrame(void)
+{
+  if (framesSent == 0)
+  {
+    return 0;
+  }
+
+  return bytesSent / framesSent;
+}
+
+void BERGCloudEventBatcher::clearStats(void)
+{
+  framesSent = 0;
+  recordsSent = 0;
+  bytesSent = 0;
+  sendFailures = 0;
+}
@@ -0,0 +1,76 @@
+/*
+
+BERGCloud event batcher
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDEVENTBATCHER_H
+#define BERGCLOUDEVENTBATCHER_H
+
+#include "BERGCloudBase.h"
+
+/* Sends successive records as the elements of a messagePack array under */
+/* one named event, so several records share one SPI transaction. Each */
+/* record must be a single packed value, e.g. an array or map. */
+
+/* Space reserved for the array header: array16 is 3 bytes */
+#define _BC_BATCH_ARRAY_HEADER_SIZE 3
+
+class BERGCloudEventBatcher
+{
+public:
+  /* maxAge_mS is the longest time a record is held before it is sent */
+  /* by service(); zero to only send when full or on flush() */
+  BERGCloudEventBatcher(BERGCloudBase& bergcloud, const char *eventName, uint32_t maxAge_mS = 0);
+  /* Add a record; sends the records held first if it would not fit */
+  bool add(const uint8_t *record, uint16_t recordSize);
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool add(BERGCloudMessageBuffer& record);
+#endif
+  /* Send the records held if the oldest has reached maxAge_mS; */
+  /* call regularly, e.g. from loop() */
+  bool service(void);
+  /* Send the records held now */
+  bool flush(void);
+  /* Number of records held */
+  uint16_t recordsHeld(void);
+  /* Statistics for the events sent */
+  uint32_t framesSent;
+  uint32_t recordsSent;
+  uint32_t bytesSent;
+  uint32_t sendFailures;
+  uint16_t recordsPerFrame(void);
+  uint16_t bytesPerFrame(void);
+  void clearStats(void);
+private:
+  BERGCloudBase *bergcloud;
+  const char *eventName;
+  uint32_t maxAge_mS;
+  _BC_TIMER age;
+  uint16_t capacity;
+  uint16_t used;
+  uint16_t records;
+  uint8_t frame[_BC_BATCH_ARRAY_HEADER_SIZE + SPI_MAX_PAYLOAD_SIZE_BYTES];
+};
+
+#endif // #ifndef BERGCLOUDEVENTBATCHER_H
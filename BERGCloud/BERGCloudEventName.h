@@ -0,0 +1,107 @@
+/*
+
+BERGCloud compile-time event names
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDEVENTNAME_H
+#define BERGCLOUDEVENTNAME_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudConst.h"
+#include "BERGCloudMessagePack.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#endif
+
+#if (__cplusplus >= 201103L)
+
+/* Longest event name that fits in a messagePack fixraw string */
+#define BC_EVENT_NAME_MAX_SIZE  _MAX_FIXRAW
+
+/* An event name that is encoded at compile time, as the SPI event */
+/* header followed by the name as a messagePack string. Declare it */
+/* with BERGCLOUD_EVENT_NAME() and pass it to sendEvent():         */
+/*                                                                 */
+/*   BERGCLOUD_EVENT_NAME(temperatureEvent, "temperature");        */
+/*   ...                                                           */
+/*   BERGCloud.sendEvent(temperatureEvent, buffer);                */
+/*                                                                 */
+/* On AVR the encoded name is stored in flash. */
+
+template <size_t L>
+struct BERGCloudEventName
+{
+  uint8_t header[SPI_EVENT_HEADER_SIZE_BYTES + 1 + L]; /* +1 for messagePack fixraw byte */
+};
+
+/* Indices 0 to N-1, used to expand the characters of the name */
+template <size_t... I>
+struct _BC_INDICES
+{
+};
+
+template <size_t N, size_t... I>
+struct _BC_MAKE_INDICES : _BC_MAKE_INDICES<N - 1, N - 1, I...>
+{
+};
+
+template <size_t... I>
+struct _BC_MAKE_INDICES<0, I...>
+{
+  typedef _BC_INDICES<I...> type;
+};
+
+template <size_t N, size_t... I>
+constexpr BERGCloudEventName<N - 1> _BC_encodeEventName(const char (&name)[N], _BC_INDICES<I...>)
+{
+  return {{
+    BC_EVENT_NAMED_PACKED & BC_EVENT_ID_MASK, 0, 0, 0,
+    (uint8_t)(_MP_FIXRAW_MIN + (N - 1)),
+    (uint8_t)name[I]...
+  }};
+}
+
+/* Encode a string literal as an event name */
+template <size_t N>
+constexpr BERGCloudEventName<N - 1> BERGCloudEncodeEventName(const char (&name)[N])
+{
+  static_assert(N > 1, "Event name must be at least one character");
+  static_assert((N - 1) <= BC_EVENT_NAME_MAX_SIZE, "Event name is too long");
+
+  return _BC_encodeEventName(name, typename _BC_MAKE_INDICES<N - 1>::type());
+}
+
+#define BERGCLOUD_EVENT_NAME(var, name) \
+  static constexpr auto var PROGMEM = BERGCloudEncodeEventName(name)
+
+#endif // #if (__cplusplus >= 201103L)
+
+#endif // #ifndef BERGCLOUDEVENTNAME_H
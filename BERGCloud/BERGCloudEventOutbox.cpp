@@ -0,0 +1,273 @@
+/*
+
+BERGCloud event outbox
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memcpy() */
+
+#include "BERGCloudEventOutbox.h"
+
+#ifdef BERGCLOUD_ASYNC
+
+/* Longest event name sent, see BERGCloudBase::createEventHeader() */
+#define _MAX_EVENT_NAME_SIZE  (_BC_EVENT_HEADER_MAX_SIZE - (SPI_EVENT_HEADER_SIZE_BYTES + 1))
+
+BERGCloudEventOutbox::BERGCloudEventOutbox(BERGCloudBase& bergcloud, uint16_t minBackoff_mS, uint16_t maxBackoff_mS)
+{
+  this->bergcloud = &bergcloud;
+  this->minBackoff_mS = minBackoff_mS;
+  this->maxBackoff_mS = (maxBackoff_mS < minBackoff_mS) ? minBackoff_mS : maxBackoff_mS;
+
+  /* Seeded again from the timer when the first event is queued */
+  seed = 0x2545f491;
+  seeded = false;
+  retryDelay_mS = 0;
+  inProgress = false;
+  first = 0;
+  count = 0;
+  clearStats();
+}
+
+bool BERGCloudEventOutbox::queue(const char *eventName, const uint8_t *eventBuffer, uint16_t eventSize, uint8_t maxRetries)
+{
+  _BC_OUTBOX_ENTRY *entry;
+  uint16_t nameSize;
+
+  if ((eventName == NULL) || (eventName[0] == '\0') || ((eventBuffer == NULL) && (eventSize > 0)))
+  {
+    return false;
+  }
+
+  nameSize = strlen(eventName);
+
+  if (nameSize > _MAX_EVENT_NAME_SIZE)
+  {
+    nameSize = _MAX_EVENT_NAME_SIZE;
+  }
+
+  /* Check against the space left after the event header */
+  if (eventSize > (SPI_MAX_PAYLOAD_SIZE_BYTES - (SPI_EVENT_HEADER_SIZE_BYTES + 1 + nameSize))) /* +1 for messagePack fixraw byte */
+  {
+    _LOG("Event is too big (BERGCloudEventOutbox::queue)\r\n");
+    return false;
+  }
+
+  if (count >= BC_OUTBOX_DEPTH)
+  {
+    overflows++;
+    return false;
+  }
+
+  if (!seeded)
+  {
+    /* Vary the jitter between devices that start together */
+    bergcloud->timerStart_uS(&retryTimer);
+    seed ^= retryTimer.start_uS;
+    seeded = true;
+  }
+
+  entry = &entries[(first + count) % BC_OUTBOX_DEPTH];
+  entry->retriesLeft = maxRetries;
+  entry->attempts = 0;
+  entry->nameSize = nameSize;
+  entry->dataSize = eventSize;
+
+  memcpy(entry->data, eventName, nameSize);
+  entry->data[nameSize] = '\0';
+  memcpy(&entry->data[nameSize + 1], eventBuffer, eventSize);
+
+  if (count == 0)
+  {
+    /* Send from the next service() */
+    retryDelay_mS = 0;
+  }
+
+  count++;
+  return true;
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudEventOutbox::queue(const char *eventName, BERGCloudMessageBuffer& buffer, uint8_t maxRetries)
+{
+  return queue(eventName, buffer.ptr(), buffer.used(), maxRetries);
+}
+#endif
+
+bool BERGCloudEventOutbox::service(void)
+{
+  _BC_OUTBOX_ENTRY *entry;
+  uint8_t status;
+  bool result = true;
+
+  while (count > 0)
+  {
+    entry = &entries[first];
+
+    if (!inProgress)
+    {
+      if ((retryDelay_mS > 0) && (bergcloud->timerElapsed_mS(&retryTimer) < retryDelay_mS))
+      {
+        /* Backing off */
+        break;
+      }
+
+      if (!bergcloud->beginSendEvent((const char *)entry->data, &entry->data[entry->nameSize + 1], entry->dataSize))
+      {
+        /* Another transaction is in progress; try again later */
+        break;
+      }
+
+      entry->attempts++;
+      inProgress = true;
+    }
+
+    status = bergcloud->step();
+
+    if (status == BC_TRANSACTION_IN_PROGRESS)
+    {
+      /* Continue from the next service() */
+      break;
+    }
+
+    inProgress = false;
+
+    if (status == BC_TRANSACTION_DONE)
+    {
+      eventsSent++;
+      remove();
+      continue;
+    }
+
+    if (!isTransient(bergcloud->stepResponse()))
+    {
+      _LOG("Event rejected (BERGCloudEventOutbox::service)\r\n");
+      permanentFailures++;
+      result = false;
+      remove();
+      continue;
+    }
+
+    transientFailures++;
+
+    if (entry->retriesLeft == 0)
+    {
+      _LOG("Out of retries (BERGCloudEventOutbox::service)\r\n");
+      retriesExhausted++;
+      result = false;
+      remove();
+      continue;
+    }
+
+    /* Try again later */
+    entry->retriesLeft--;
+    retryDelay_mS = backoff_mS(entry->attempts);
+    bergcloud->timerStart(&retryTimer);
+    break;
+  }
+
+  return result;
+}
+
+bool BERGCloudEventOutbox::sending(void)
+{
+  return inProgress;
+}
+
+uint8_t BERGCloudEventOutbox::eventsQueued(void)
+{
+  return count;
+}
+
+void BERGCloudEventOutbox::clearStats(void)
+{
+  eventsSent = 0;
+  transientFailures = 0;
+  permanentFailures = 0;
+  retriesExhausted = 0;
+  overflows = 0;
+}
+
+bool BERGCloudEventOutbox::isTransient(uint8_t response)
+{
+  switch (response)
+  {
+    case SPI_RSP_SUCCESS: /* Transport error */
+    case SPI_RSP_BUSY:
+    case SPI_RSP_NO_FREE_BUFFERS:
+    case SPI_RSP_SEND_FAILED:
+      return true;
+    default:
+      return false;
+  }
+}
+
+uint32_t BERGCloudEventOutbox::backoff_mS(uint8_t attempts)
+{
+  /* Doubles after each attempt up to the maximum, then add up to 50% */
+  /* random jitter so devices that failed together don't retry together */
+
+  uint32_t delay_mS = minBackoff_mS;
+
+  while ((attempts > 1) && (delay_mS < maxBackoff_mS))
+  {
+    delay_mS <<= 1;
+    attempts--;
+  }
+
+  if (delay_mS > maxBackoff_mS)
+  {
+    delay_mS = maxBackoff_mS;
+  }
+
+  return delay_mS + (nextRandom() % ((delay_mS / 2) + 1));
+}
+
+uint32_t BERGCloudEventOutbox::nextRandom(void)
+{
+  /* xorshift32; zero is a fixed point */
+  if (seed == 0)
+  {
+    seed = 1;
+  }
+
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+void BERGCloudEventOutbox::remove(void)
+{
+  first = (first + 1) % BC_OUTBOX_DEPTH;
+  count--;
+
+  /* The next event is sent without waiting */
+  retryDelay_mS = 0;
+}
+
+#endif // #ifdef BERGCLOUD_ASYNC
@@ -0,0 +1,98 @@
+/*
+
+BERGCloud event outbox
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDEVENTOUTBOX_H
+#define BERGCLOUDEVENTOUTBOX_H
+
+#include "BERGCloudBase.h"
+
+#ifdef BERGCLOUD_ASYNC
+
+/* Holds events and sends them from service(), retrying with exponential */
+/* backoff and jitter when the shield can't accept them. Events are sent */
+/* in the order they were queued, with beginSendEvent() and step(), so */
+/* service() never waits for the shield. Don't start other non-blocking */
+/* transactions on the same shield while events are queued. */
+
+typedef struct {
+  uint8_t retriesLeft;
+  uint8_t attempts;
+  uint8_t nameSize;
+  uint16_t dataSize;
+  /* Null-terminated event name followed by the packed data */
+  uint8_t data[SPI_MAX_PAYLOAD_SIZE_BYTES];
+} _BC_OUTBOX_ENTRY;
+
+class BERGCloudEventOutbox
+{
+public:
+  BERGCloudEventOutbox(BERGCloudBase& bergcloud, uint16_t minBackoff_mS = BC_OUTBOX_MIN_BACKOFF_MS, uint16_t maxBackoff_mS = BC_OUTBOX_MAX_BACKOFF_MS);
+  /* Copy an event into the outbox; returns FALSE if it is full or */
+  /* the event is invalid */
+  bool queue(const char *eventName, const uint8_t *eventBuffer, uint16_t eventSize, uint8_t maxRetries = BC_OUTBOX_MAX_RETRIES);
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool queue(const char *eventName, BERGCloudMessageBuffer& buffer, uint8_t maxRetries = BC_OUTBOX_MAX_RETRIES);
+#endif
+  /* Send any events that are due; never waits, call regularly */
+  /* e.g. from loop(). Returns FALSE if an event was dropped. */
+  bool service(void);
+  /* TRUE while an event is part way through being sent */
+  bool sending(void);
+  /* Number of events waiting to be sent */
+  uint8_t eventsQueued(void);
+  /* Statistics */
+  uint32_t eventsSent;
+  /* BUSY, NO_FREE_BUFFERS, SEND_FAILED or a transport error; retried */
+  uint32_t transientFailures;
+  /* Any other response; the event is dropped */
+  uint32_t permanentFailures;
+  /* Events dropped after using all their retries */
+  uint32_t retriesExhausted;
+  /* Events refused by queue() because the outbox was full */
+  uint32_t overflows;
+  void clearStats(void);
+private:
+  bool isTransient(uint8_t response);
+  uint32_t backoff_mS(uint8_t attempts);
+  uint32_t nextRandom(void);
+  void remove(void);
+  BERGCloudBase *bergcloud;
+  uint16_t minBackoff_mS;
+  uint16_t maxBackoff_mS;
+  uint32_t seed;
+  bool seeded;
+  /* Wait before sending the first event again */
+  _BC_TIMER retryTimer;
+  uint32_t retryDelay_mS;
+  bool inProgress;
+  uint8_t first;
+  uint8_t count;
+  _BC_OUTBOX_ENTRY entries[BC_OUTBOX_DEPTH];
+};
+
+#endif // #ifdef BERGCLOUD_ASYNC
+
+#endif // #ifndef BERGCLOUDEVENTOUTBOX_H
@@ -0,0 +1,260 @@
+/*
+
+BERGCloud library for Linux
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#ifdef LINUX
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memset() */
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
+
+#include "BERGCloudLinux.h"
+
+BERGCloudLinux::BERGCloudLinux(void)
+{
+  fd = -1;
+  speed = BC_LINUX_SPI_SPEED_HZ;
+  resetTime = 0;
+}
+
+BERGCloudLinux::~BERGCloudLinux(void)
+{
+  end();
+}
+
+uint16_t BERGCloudLinux::SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS)
+{
+  struct spi_ioc_transfer xfer;
+
+  if ( (dataOut == NULL) || (dataIn == NULL) || (fd < 0) )
+  {
+    _LOG("Invalid parameter (BERGCloudLinux::SPITransaction)\r\n");
+    return 0;
+  }
+
+  /* The whole buffer is clocked as a single full-duplex transfer; */
+  /* cs_change on the last transfer of a message keeps nCS asserted */
+  /* until the next message, so it is set unless this is the end of */
+  /* the protocol transaction. */
+  memset(&xfer, 0x00, sizeof(xfer));
+  xfer.tx_buf = (unsigned long)dataOut;
+  xfer.rx_buf = (unsigned long)dataIn;
+  xfer.len = dataSize;
+  xfer.speed_hz = speed;
+  xfer.bits_per_word = 8;
+  xfer.cs_change = finalCS ? 0 : 1;
+
+  if (ioctl(fd, SPI_IOC_MESSAGE(1), &xfer) < 0)
+  {
+    _LOG("ioctl failed (BERGCloudLinux::SPITransaction)\r\n");
+    return 0;
+  }
+
+  return dataSize;
+}
+
+uint16_t BERGCloudLinux::SPITransactionSegments(BERGCloudSPISegment *segment, uint8_t count, bool finalCS)
+{
+  struct spi_ioc_transfer xfer[BC_SPI_MAX_SEGMENTS];
+  uint16_t dataSize = 0;
+  uint8_t transfers = 0;
+  uint8_t i;
+
+  if ( (segment == NULL) || (count > BC_SPI_MAX_SEGMENTS) || (fd < 0) )
+  {
+    _LOG("Invalid parameter (BERGCloudLinux::SPITransactionSegments)\r\n");
+    return 0;
+  }
+
+  /* One message of several transfers, so the driver moves every */
+  /* segment in one operation with nCS held low between them */
+  memset(xfer, 0x00, sizeof(xfer));
+
+  for (i=0; i<count; i++)
+  {
+    if (segment[i].dataSize == 0)
+    {
+      continue;
+    }
+
+    xfer[transfers].tx_buf = (unsigned long)segment[i].dataOut;
+    xfer[transfers].rx_buf = (unsigned long)segment[i].dataIn;
+    xfer[transfers].len = segment[i].dataSize;
+    xfer[transfers].speed_hz = speed;
+    xfer[transfers].bits_per_word = 8;
+    transfers++;
+
+    dataSize += segment[i].dataSize;
+  }
+
+  if (transfers == 0)
+  {
+    return 0;
+  }
+
+  /* See SPITransaction() */
+  xfer[transfers - 1].cs_change = finalCS ? 0 : 1;
+
+  if (ioctl(fd, SPI_IOC_MESSAGE(transfers), xfer) < 0)
+  {
+    _LOG("ioctl failed (BERGCloudLinux::SPITransactionSegments)\r\n");
+    return 0;
+  }
+
+  return dataSize;
+}
+
+void BERGCloudLinux::SPIDeselect(void)
+{
+  struct spi_ioc_transfer xfer;
+
+  if (fd < 0)
+  {
+    return;
+  }
+
+  /* An empty message without cs_change leaves nCS deasserted */
+  memset(&xfer, 0x00, sizeof(xfer));
+  xfer.speed_hz = speed;
+  xfer.bits_per_word = 8;
+
+  if (ioctl(fd, SPI_IOC_MESSAGE(1), &xfer) < 0)
+  {
+    _LOG("ioctl failed (BERGCloudLinux::SPIDeselect)\r\n");
+  }
+}
+
+uint32_t BERGCloudLinux::timerNow_mS(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint32_t)ts.tv_sec * 1000) + (uint32_t)(ts.tv_nsec / 1000000);
+}
+
+void BERGCloudLinux::timerReset(void)
+{
+  resetTime = timerNow_mS();
+}
+
+uint32_t BERGCloudLinux::timerRead_mS(void)
+{
+  return timerNow_mS() - resetTime;
+}
+
+void BERGCloudLinux::timerWait_uS(uint32_t time_uS)
+{
+  struct timespec ts;
+
+  ts.tv_sec = time_uS / 1000000;
+  ts.tv_nsec = (time_uS % 1000000) * 1000;
+
+  /* Restart if interrupted by a signal */
+  while (nanosleep(&ts, &ts) < 0)
+  {
+    if (errno != EINTR)
+    {
+      break;
+    }
+  }
+}
+
+uint32_t BERGCloudLinux::timerNow_uS(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint32_t)ts.tv_sec * 1000000) + (uint32_t)(ts.tv_nsec / 1000);
+}
+
+bool BERGCloudLinux::begin(const char *device, uint32_t speedHz)
+{
+  uint8_t mode = SPI_MODE_0;
+  uint8_t bits = 8;
+  uint8_t lsbFirst = 0;
+
+  /* Call base class method */
+  BERGCloudBase::begin();
+
+  if (device == NULL)
+  {
+    _LOG("Device is NULL (BERGCloudLinux::begin)\r\n");
+    return false;
+  }
+
+  /* Close any device that is already open */
+  end();
+
+  fd = open(device, O_RDWR);
+
+  if (fd < 0)
+  {
+    _LOG("Can't open device (BERGCloudLinux::begin)\r\n");
+    return false;
+  }
+
+  /* Configure SPI */
+  speed = speedHz;
+
+  if ((ioctl(fd, SPI_IOC_WR_MODE, &mode) < 0) ||
+      (ioctl(fd, SPI_IOC_WR_LSB_FIRST, &lsbFirst) < 0) ||
+      (ioctl(fd, SPI_IOC_WR_BITS_PER_WORD, &bits) < 0) ||
+      (ioctl(fd, SPI_IOC_WR_MAX_SPEED_HZ, &speed) < 0))
+  {
+    _LOG("Can't configure device (BERGCloudLinux::begin)\r\n");
+    close(fd);
+    fd = -1;
+    return false;
+  }
+
+  return true;
+}
+
+void BERGCloudLinux::end()
+{
+  /* Deconfigure SPI */
+  if (fd >= 0)
+  {
+    close(fd);
+    fd = -1;
+
+    /* Call base class method */
+    BERGCloudBase::end();
+  }
+}
+
+uint16_t BERGCloudLinux::getHostType(void)
+{
+  return BC_HOST_LINUX;
+}
+
+#endif // #ifdef LINUX
@@ -0,0 +1,73 @@
+/*
+
+BERGCloud library for Linux
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDLINUX_H
+#define BERGCLOUDLINUX_H
+
+#include "BERGCloudBase.h"
+
+#ifdef BERGCLOUD_PACK_UNPACK
+#include "BERGCloudMessageBase.h"
+#endif
+
+/* Default spidev device and clock rate */
+#define BC_LINUX_SPI_DEVICE    "/dev/spidev0.0"
+#define BC_LINUX_SPI_SPEED_HZ  4000000
+
+class BERGCloudLinux : public BERGCloudBase
+{
+public:
+  BERGCloudLinux(void);
+  ~BERGCloudLinux(void);
+  bool begin(const char *device = BC_LINUX_SPI_DEVICE, uint32_t speedHz = BC_LINUX_SPI_SPEED_HZ);
+  void end();
+private:
+  uint16_t SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS);
+  uint16_t SPITransactionSegments(BERGCloudSPISegment *segment, uint8_t count, bool finalCS);
+  void SPIDeselect(void);
+  uint16_t getHostType(void);
+  void timerReset(void);
+  uint32_t timerRead_mS(void);
+  uint32_t timerNow_mS(void);
+  uint32_t timerNow_uS(void);
+  void timerWait_uS(uint32_t time_uS);
+  int fd;
+  uint32_t speed;
+  uint32_t resetTime;
+};
+
+#ifdef BERGCLOUD_PACK_UNPACK
+
+class BERGCloudMessage : public BERGCloudMessageBase
+{
+public:
+  using BERGCloudMessageBase::pack;
+  using BERGCloudMessageBase::unpack;
+};
+
+#endif // #ifdef BERGCLOUD_PACK_UNPACK
+
+#endif // #ifndef BERGCLOUDLINUX_H
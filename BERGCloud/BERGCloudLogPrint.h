@@ -45,6 +45,7 @@ THE SOFTWARE.
 #endif // #ifdef ARDUINO
 #else // #ifdef BERGCLOUD_LOG
 #define _LOG(x)
+#define _LOG_HEX(x)
 #endif // #ifdef BERGCLOUD_LOG
 
 #endif // #ifndef BERGCLOUDLOGPRINT_H
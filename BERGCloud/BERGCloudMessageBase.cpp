@@ -30,49 +30,32 @@ THE SOFTWARE.
 #include <stdint.h>
 #include <stddef.h> /* For NULL */
 #include <string.h> /* For memcpy() */
+#include <float.h> /* For FLT_MAX */
 #include "BERGCloudMessageBase.h"
+#include "BERGCloudMessagePack.h"
+#include "BERGCloudByteSwap.h"
 
 BERGCloudMessageBase::BERGCloudMessageBase(void)
 {
+  compact = false;
 }
 
 BERGCloudMessageBase::~BERGCloudMessageBase(void)
 {
 }
 
-#define _MP_FIXNUM_POS_MIN  0x00
-#define _MP_FIXNUM_POS_MAX  0x7f
-#define _MP_FIXMAP_MIN      0x80
-#define _MP_FIXMAP_MAX      0x8f
-#define _MP_FIXARRAY_MIN    0x90
-#define _MP_FIXARRAY_MAX    0x9f
-#define _MP_FIXRAW_MIN      0xa0
-#define _MP_FIXRAW_MAX      0xbf
-#define _MP_NIL             0xc0
-#define _MP_BOOL_FALSE      0xc2
-#define _MP_BOOL_TRUE       0xc3
-#define _MP_FLOAT           0xca
-#define _MP_DOUBLE          0xcb
-#define _MP_UINT8           0xcc
-#define _MP_UINT16          0xcd
-#define _MP_UINT32          0xce
-#define _MP_UINT64          0xcf
-#define _MP_INT8            0xd0
-#define _MP_INT16           0xd1
-#define _MP_INT32           0xd2
-#define _MP_INT64           0xd3
-#define _MP_RAW16           0xda
-#define _MP_RAW32           0xdb
-#define _MP_ARRAY16         0xdc
-#define _MP_ARRAY32         0xdd
-#define _MP_MAP16           0xde
-#define _MP_MAP32           0xdf
-#define _MP_FIXNUM_NEG_MIN  0xe0
-#define _MP_FIXNUM_NEG_MAX  0xff
-
-#define _MAX_FIXRAW         (_MP_FIXRAW_MAX - _MP_FIXRAW_MIN)
-#define _MAX_FIXARRAY       (_MP_FIXARRAY_MAX - _MP_FIXARRAY_MIN)
-#define _MAX_FIXMAP         (_MP_FIXMAP_MAX - _MP_FIXMAP_MIN)
+/* Byte order flag for typed arrays packed on this host */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define _BC_TYPED_ARRAY_HOST_ORDER  BC_TYPED_ARRAY_BIG_ENDIAN
+#else
+#define _BC_TYPED_ARRAY_HOST_ORDER  0
+#endif
+
+/* Bytes per element, indexed by BC_TYPED_ARRAY_UINT8 etc. */
+static const uint8_t typedArrayWidth[] = { 1, 1, 2, 2, 4, 4, 8, 8, 4 };
+
+/* Space for a raw 16 header in front of data written in place */
+#define _RAW16_HEADER_SIZE 3
 
 uint16_t BERGCloudMessageBase::strlen(const char *string)
 {
@@ -122,8 +105,124 @@ bool BERGCloudMessageBase::strcompare(const char *s1, const char *s2)
     Pack methods
 */
 
+void BERGCloudMessageBase::pack_compact(bool enable)
+{
+  compact = enable;
+}
+
+bool BERGCloudMessageBase::pack_integer(uint8_t type, uint32_t n, uint8_t sizeInBytes)
+{
+  /* Pack a type byte followed by the low 'sizeInBytes' bytes of 'n', */
+  /* most significant first */
+
+  if (!available(sizeInBytes + 1))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  add(type);
+
+  while (sizeInBytes-- > 0)
+  {
+    add((uint8_t)(n >> (sizeInBytes * 8)));
+  }
+
+  return true;
+}
+
+bool BERGCloudMessageBase::pack_integer64(uint8_t type, uint32_t high, uint32_t low)
+{
+  /* Pack a type byte followed by 8 bytes, most significant first; the */
+  /* value is passed as two halves to avoid 64-bit shifts on AVR */
+
+  if (!available(sizeof(uint64_t) + 1))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  add(type);
+  add((uint8_t)(high >> 24));
+  add((uint8_t)(high >> 16));
+  add((uint8_t)(high >> 8));
+  add((uint8_t)high);
+  add((uint8_t)(low >> 24));
+  add((uint8_t)(low >> 16));
+  add((uint8_t)(low >> 8));
+  add((uint8_t)low);
+  return true;
+}
+
+bool BERGCloudMessageBase::pack_compact_unsigned(uint32_t n)
+{
+  if (n <= _MP_FIXNUM_POS_MAX)
+  {
+    /* Use positive fix num */
+    if (!available(1))
+    {
+      _LOG_PACK_ERROR_NO_SPACE;
+      return false;
+    }
+
+    add((uint8_t)n);
+    return true;
+  }
+
+  if (n <= UINT8_MAX)
+  {
+    return pack_integer(_MP_UINT8, n, sizeof(uint8_t));
+  }
+
+  if (n <= UINT16_MAX)
+  {
+    return pack_integer(_MP_UINT16, n, sizeof(uint16_t));
+  }
+
+  return pack_integer(_MP_UINT32, n, sizeof(uint32_t));
+}
+
+bool BERGCloudMessageBase::pack_compact_signed(int32_t n)
+{
+  if (n >= 0)
+  {
+    /* Positive values use the unsigned forms */
+    return pack_compact_unsigned((uint32_t)n);
+  }
+
+  if (n >= -32)
+  {
+    /* Use negative fix num */
+    if (!available(1))
+    {
+      _LOG_PACK_ERROR_NO_SPACE;
+      return false;
+    }
+
+    add((uint8_t)n);
+    return true;
+  }
+
+  if (n >= INT8_MIN)
+  {
+    return pack_integer(_MP_INT8, (uint32_t)n, sizeof(int8_t));
+  }
+
+  if (n >= INT16_MIN)
+  {
+    return pack_integer(_MP_INT16, (uint32_t)n, sizeof(int16_t));
+  }
+
+  return pack_integer(_MP_INT32, (uint32_t)n, sizeof(int32_t));
+}
+
 bool BERGCloudMessageBase::pack(uint8_t n)
 {
+  if (compact)
+  {
+    return pack_compact_unsigned(n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -137,6 +236,11 @@ bool BERGCloudMessageBase::pack(uint8_t n)
 
 bool BERGCloudMessageBase::pack(uint16_t n)
 {
+  if (compact)
+  {
+    return pack_compact_unsigned(n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -151,6 +255,11 @@ bool BERGCloudMessageBase::pack(uint16_t n)
 
 bool BERGCloudMessageBase::pack(uint32_t n)
 {
+  if (compact)
+  {
+    return pack_compact_unsigned(n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -167,6 +276,11 @@ bool BERGCloudMessageBase::pack(uint32_t n)
 
 bool BERGCloudMessageBase::pack(int8_t n)
 {
+  if (compact)
+  {
+    return pack_compact_signed(n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -180,6 +294,11 @@ bool BERGCloudMessageBase::pack(int8_t n)
 
 bool BERGCloudMessageBase::pack(int16_t n)
 {
+  if (compact)
+  {
+    return pack_compact_signed(n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -194,6 +313,11 @@ bool BERGCloudMessageBase::pack(int16_t n)
 
 bool BERGCloudMessageBase::pack(int32_t n)
 {
+  if (compact)
+  {
+    return pack_compact_signed(n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -208,6 +332,26 @@ bool BERGCloudMessageBase::pack(int32_t n)
   return true;
 }
 
+bool BERGCloudMessageBase::pack(uint64_t n)
+{
+  if (compact && (n <= UINT32_MAX))
+  {
+    return pack_compact_unsigned((uint32_t)n);
+  }
+
+  return pack_integer64(_MP_UINT64, (uint32_t)(n >> 32), (uint32_t)n);
+}
+
+bool BERGCloudMessageBase::pack(int64_t n)
+{
+  if (compact && IN_RANGE(n, INT32_MIN, INT32_MAX))
+  {
+    return pack_compact_signed((int32_t)n);
+  }
+
+  return pack_integer64(_MP_INT64, (uint32_t)((uint64_t)n >> 32), (uint32_t)n);
+}
+
 bool BERGCloudMessageBase::pack(float n)
 {
   uint32_t data;
@@ -229,6 +373,23 @@ bool BERGCloudMessageBase::pack(float n)
   return true;
 }
 
+bool BERGCloudMessageBase::pack(double n)
+{
+  uint64_t data = 0;
+
+  /* On 8-bit AVR a double is the same as a float; this is also */
+  /* what makes pack(1.234) work there */
+  if (sizeof(double) == sizeof(float))
+  {
+    return pack((float)n);
+  }
+
+  /* Convert to data */
+  memcpy(&data, &n, sizeof(double));
+
+  return pack_integer64(_MP_DOUBLE, (uint32_t)(data >> 32), (uint32_t)data);
+}
+
 bool BERGCloudMessageBase::pack(bool n)
 {
   /*
@@ -341,6 +502,44 @@ bool BERGCloudMessageBase::pack(const char *string)
   return pack((uint8_t *)string, strLen);
 }
 
+uint8_t *BERGCloudMessageBase::pack_raw_begin(uint16_t& maxSizeInBytes)
+{
+  /* Leave space for the largest raw header in front of the data */
+  if (!available(_RAW16_HEADER_SIZE))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    maxSizeInBytes = 0;
+    return NULL;
+  }
+
+  maxSizeInBytes = available() - _RAW16_HEADER_SIZE;
+  return &buffer[start + bytesWritten + _RAW16_HEADER_SIZE];
+}
+
+bool BERGCloudMessageBase::pack_raw_end(uint16_t sizeInBytes)
+{
+  /* Pack the header, then move the data up to it if the header */
+  /* was smaller than the space left for it */
+  uint8_t *data;
+
+  if (!available(sizeInBytes + _RAW16_HEADER_SIZE))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  data = &buffer[start + bytesWritten + _RAW16_HEADER_SIZE];
+
+  if (!pack_raw_header(sizeInBytes))
+  {
+    return false;
+  }
+
+  memmove(&buffer[start + bytesWritten], data, sizeInBytes);
+  bytesWritten += sizeInBytes;
+  return true;
+}
+
 /* Separate header and data methods are provided for raw data*/
 /* so that Arduino strings may be packed without having to create */
 /* a temporary buffer first. */
@@ -386,151 +585,386 @@ bool BERGCloudMessageBase::pack_raw_data(uint8_t *data, uint16_t sizeInBytes)
   return true;
 }
 
-/*
-    Unpack methods
-*/
-
-bool BERGCloudMessageBase::unpack_peek(uint8_t& messagePackType)
-{
-  return peek(&messagePackType);
-}
-
-#ifdef BERGCLOUD_LOG
-bool BERGCloudMessageBase::unpack_peek(void)
+bool BERGCloudMessageBase::pack_items(const void *values, uint16_t count, uint8_t width, uint8_t type)
 {
-  uint8_t type;
+  /* Pack an array header and 'count' fixed-width items with one */
+  /* check for space */
+  uint32_t sizeInBytes;
 
-  if (!peek(&type))
+  if ((values == NULL) && (count > 0))
   {
+    _LOG("Values is NULL (BERGCloudMessageBase::pack_items)\r\n");
     return false;
   }
 
-  if (type <= _MP_FIXNUM_POS_MAX)
-  {
-    _LOG("Positive integer\r\n");
-    return true;
-  }
-
-  if (IN_RANGE(type, _MP_FIXNUM_NEG_MIN, _MP_FIXNUM_NEG_MAX))
-  {
-    _LOG("Negative integer\r\n");
-    return true;
-  }
+  sizeInBytes = (uint32_t)count * (width + 1);
+  sizeInBytes += (count <= _MAX_FIXARRAY) ? 1 : 1 + sizeof(uint16_t);
 
-  if ((type == _MP_MAP16) || (type == _MP_MAP32) || IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX))
+  if (sizeInBytes > available())
   {
-    _LOG("Map\r\n");
-    return true;
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
   }
 
-  if ((type == _MP_ARRAY16) || (type == _MP_ARRAY32) || IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX))
+  if (count <= _MAX_FIXARRAY)
   {
-    _LOG("Array\r\n");
-    return true;
+    add(_MP_FIXARRAY_MIN + count);
   }
-
-  if ((type == _MP_RAW16) || (type == _MP_RAW32) || IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
+  else
   {
-    _LOG("Raw\r\n");
-    return true;
+    add(_MP_ARRAY16);
+    add((uint8_t)(count >> 8));
+    add((uint8_t)count);
   }
 
-  if ((type ==_MP_UINT8) || (type == _MP_UINT16) || (type == _MP_UINT32) || (type == _MP_UINT64))
-  {
-    _LOG("Unsigned integer\r\n");
-    return true;
-  }
+  byteswap_pack(&buffer[start + bytesWritten], values, count, width, type);
+  bytesWritten += count * (width + 1);
+  return true;
+}
 
-  if ((type ==_MP_INT8) || (type == _MP_INT16) || (type == _MP_INT32) || (type == _MP_INT64))
-  {
-    _LOG("Signed integer\r\n");
-    return true;
-  }
+template <typename T>
+bool BERGCloudMessageBase::pack_values(const T *values, uint16_t count, uint8_t type)
+{
+  /* Pack an array of values of the fixed-width 'type' */
+  uint16_t i;
 
-  if (type == _MP_NIL)
+  if (!compact)
   {
-    _LOG("Nil\r\n");
-    return true;
+    return pack_items(values, count, sizeof(T), type);
   }
 
-  if (type == _MP_BOOL_FALSE)
+  /* Compact items vary in size so are packed one at a time */
+  if (!pack_array(count))
   {
-    _LOG("Boolean false\r\n");
-    return true;
+    return false;
   }
 
-  if (type == _MP_BOOL_TRUE)
+  for (i=0; i<count; i++)
   {
-    _LOG("Boolean true\r\n");
-    return true;
+    if (!pack(values[i]))
+    {
+      return false;
+    }
   }
 
-  if (type == _MP_FLOAT)
-  {
-    _LOG("Float\r\n");
-    return true;
-  }
+  return true;
+}
 
-  if (type == _MP_DOUBLE)
-  {
-    _LOG("Double\r\n");
-    return true;
-  }
+bool BERGCloudMessageBase::pack_array(const uint8_t *values, uint16_t count)
+{
+  return pack_values(values, count, _MP_UINT8);
+}
 
-  _LOG("Unknown\r\n");
-  return false;
+bool BERGCloudMessageBase::pack_array(const uint16_t *values, uint16_t count)
+{
+  return pack_values(values, count, _MP_UINT16);
 }
 
-void BERGCloudMessageBase::print(void)
+bool BERGCloudMessageBase::pack_array(const uint32_t *values, uint16_t count)
 {
-  uint16_t last_read;
+  return pack_values(values, count, _MP_UINT32);
+}
 
-  /* Remember the current read position in the raw data */
-  last_read = bytesRead;
+bool BERGCloudMessageBase::pack_array(const uint64_t *values, uint16_t count)
+{
+  return pack_values(values, count, _MP_UINT64);
+}
 
-  /* Start reading from the beginning of the data */
-  restart();
+bool BERGCloudMessageBase::pack_array(const int8_t *values, uint16_t count)
+{
+  return pack_values(values, count, _MP_INT8);
+}
 
-  /* Print all items */
-  while(unpack_peek())
-  {
-    unpack_skip();
-  }
+bool BERGCloudMessageBase::pack_array(const int16_t *values, uint16_t count)
+{
+  return pack_values(values, count, _MP_INT16);
+}
 
-  /* Return to the last position */
-  bytesRead = last_read;
+bool BERGCloudMessageBase::pack_array(const int32_t *values, uint16_t count)
+{
+  return pack_values(values, count, _MP_INT32);
 }
 
-void BERGCloudMessageBase::print_bytes(void)
+bool BERGCloudMessageBase::pack_array(const int64_t *values, uint16_t count)
 {
-  uint16_t size = used();
-  uint8_t *data = ptr();
+  return pack_values(values, count, _MP_INT64);
+}
 
-  while (size-- > 0)
-  {
-    _LOG_HEX(*data);
-    _LOG(" ");
-    data++;
-  }
-  _LOG("\r\n");
+bool BERGCloudMessageBase::pack_array(const float *values, uint16_t count)
+{
+  return pack_items(values, count, sizeof(float), _MP_FLOAT);
 }
-#endif
 
-bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t min, uint32_t max)
+bool BERGCloudMessageBase::pack_typed(const void *values, uint16_t count, uint8_t elementType)
 {
-  uint8_t type;
-  uint32_t unsignedValue;
-  int32_t signedValue;
+  /* Pack the values as they are in memory as one ext item, with an */
+  /* ext type that gives the element type and byte order */
+  uint32_t sizeInBytes;
+  uint8_t headerSize;
 
-  /* Look at next type */
-  if (!peek(&type))
+  if ((values == NULL) && (count > 0))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
+    _LOG("Values is NULL (BERGCloudMessageBase::pack_typed)\r\n");
     return false;
   }
 
-  /*
-   * Unsigned types
+  sizeInBytes = (uint32_t)count * typedArrayWidth[elementType];
+
+  if ((sizeInBytes == 1) || (sizeInBytes == 2) || (sizeInBytes == 4) ||
+      (sizeInBytes == 8) || (sizeInBytes == 16))
+  {
+    headerSize = 2;
+  }
+  else if (sizeInBytes <= UINT8_MAX)
+  {
+    headerSize = 3;
+  }
+  else
+  {
+    headerSize = 4;
+  }
+
+  if ((sizeInBytes + headerSize) > available())
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  switch (sizeInBytes)
+  {
+  case 1:
+    add(_MP_FIXEXT1);
+    break;
+  case 2:
+    add(_MP_FIXEXT2);
+    break;
+  case 4:
+    add(_MP_FIXEXT4);
+    break;
+  case 8:
+    add(_MP_FIXEXT8);
+    break;
+  case 16:
+    add(_MP_FIXEXT16);
+    break;
+  default:
+    if (sizeInBytes <= UINT8_MAX)
+    {
+      add(_MP_EXT8);
+      add((uint8_t)sizeInBytes);
+    }
+    else
+    {
+      add(_MP_EXT16);
+      add((uint8_t)(sizeInBytes >> 8));
+      add((uint8_t)sizeInBytes);
+    }
+    break;
+  }
+
+  add(BC_TYPED_ARRAY_EXT_TYPE | _BC_TYPED_ARRAY_HOST_ORDER | elementType);
+
+  memcpy(&buffer[start + bytesWritten], values, sizeInBytes);
+  bytesWritten += sizeInBytes;
+  return true;
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const uint8_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_UINT8);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const uint16_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_UINT16);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const uint32_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_UINT32);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const uint64_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_UINT64);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const int8_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_INT8);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const int16_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_INT16);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const int32_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_INT32);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const int64_t *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_INT64);
+}
+
+bool BERGCloudMessageBase::pack_typed_array(const float *values, uint16_t count)
+{
+  return pack_typed(values, count, BC_TYPED_ARRAY_FLOAT);
+}
+
+/*
+    Unpack methods
+*/
+
+bool BERGCloudMessageBase::unpack_peek(uint8_t& messagePackType)
+{
+  return peek(&messagePackType);
+}
+
+#ifdef BERGCLOUD_LOG
+bool BERGCloudMessageBase::unpack_peek(void)
+{
+  uint8_t type;
+
+  if (!peek(&type))
+  {
+    return false;
+  }
+
+  if (type <= _MP_FIXNUM_POS_MAX)
+  {
+    _LOG("Positive integer\r\n");
+    return true;
+  }
+
+  if (IN_RANGE(type, _MP_FIXNUM_NEG_MIN, _MP_FIXNUM_NEG_MAX))
+  {
+    _LOG("Negative integer\r\n");
+    return true;
+  }
+
+  if ((type == _MP_MAP16) || (type == _MP_MAP32) || IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX))
+  {
+    _LOG("Map\r\n");
+    return true;
+  }
+
+  if ((type == _MP_ARRAY16) || (type == _MP_ARRAY32) || IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX))
+  {
+    _LOG("Array\r\n");
+    return true;
+  }
+
+  if ((type == _MP_RAW16) || (type == _MP_RAW32) || IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
+  {
+    _LOG("Raw\r\n");
+    return true;
+  }
+
+  if ((type ==_MP_UINT8) || (type == _MP_UINT16) || (type == _MP_UINT32) || (type == _MP_UINT64))
+  {
+    _LOG("Unsigned integer\r\n");
+    return true;
+  }
+
+  if ((type ==_MP_INT8) || (type == _MP_INT16) || (type == _MP_INT32) || (type == _MP_INT64))
+  {
+    _LOG("Signed integer\r\n");
+    return true;
+  }
+
+  if (type == _MP_NIL)
+  {
+    _LOG("Nil\r\n");
+    return true;
+  }
+
+  if (type == _MP_BOOL_FALSE)
+  {
+    _LOG("Boolean false\r\n");
+    return true;
+  }
+
+  if (type == _MP_BOOL_TRUE)
+  {
+    _LOG("Boolean true\r\n");
+    return true;
+  }
+
+  if (type == _MP_FLOAT)
+  {
+    _LOG("Float\r\n");
+    return true;
+  }
+
+  if (type == _MP_DOUBLE)
+  {
+    _LOG("Double\r\n");
+    return true;
+  }
+
+  if ((type == _MP_EXT8) || (type == _MP_EXT16) || (type == _MP_EXT32) || IN_RANGE(type, _MP_FIXEXT1, _MP_FIXEXT16))
+  {
+    _LOG("Ext\r\n");
+    return true;
+  }
+
+  _LOG("Unknown\r\n");
+  return false;
+}
+
+void BERGCloudMessageBase::print(void)
+{
+  uint16_t last_read;
+
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+
+  /* Start reading from the beginning of the data */
+  restart();
+
+  /* Print all items */
+  while(unpack_peek())
+  {
+    unpack_skip();
+  }
+
+  /* Return to the last position */
+  bytesRead = last_read;
+}
+
+void BERGCloudMessageBase::print_bytes(void)
+{
+  uint16_t size = used();
+  uint8_t *data = ptr();
+
+  while (size-- > 0)
+  {
+    _LOG_HEX(*data);
+    _LOG(" ");
+    data++;
+  }
+  _LOG("\r\n");
+}
+#endif
+
+bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t min, uint32_t max)
+{
+  uint8_t type;
+  uint32_t unsignedValue;
+  int32_t signedValue;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  /*
+   * Unsigned types
    */
 
   if (type <= _MP_FIXNUM_POS_MAX)
@@ -588,6 +1022,43 @@ bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t m
     unsignedValue <<= 8;
     unsignedValue |= read();
   }
+#ifdef BERGCLOUD_UNPACK_NARROW_64
+  else if (type == _MP_UINT64)
+  {
+    uint32_t high;
+
+    if (!remaining(sizeof(uint64_t)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read type */
+    read();
+
+    /* Read 64-bit unsigned integer; the upper half must be zero */
+    high = read();
+    high <<= 8;
+    high |= read();
+    high <<= 8;
+    high |= read();
+    high <<= 8;
+    high |= read();
+    unsignedValue = read();
+    unsignedValue <<= 8;
+    unsignedValue |= read();
+    unsignedValue <<= 8;
+    unsignedValue |= read();
+    unsignedValue <<= 8;
+    unsignedValue |= read();
+
+    if (high != 0)
+    {
+      _LOG_UNPACK_ERROR_RANGE;
+      return false;
+    }
+  }
+#endif
   else
   {
     /*
@@ -657,6 +1128,45 @@ bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t m
       temp |= read();
       signedValue = (int32_t)temp; /* Convert */
     }
+#ifdef BERGCLOUD_UNPACK_NARROW_64
+    else if (type == _MP_INT64)
+    {
+      if (!remaining(sizeof(int64_t)))
+      {
+        _LOG_UNPACK_ERROR_NO_DATA;
+        return false;
+      }
+
+      /* Read type */
+      read();
+
+      /* Read 64-bit signed integer; the upper half must be */
+      /* the sign extension of the lower half */
+      uint32_t high;
+      high = read();
+      high <<= 8;
+      high |= read();
+      high <<= 8;
+      high |= read();
+      high <<= 8;
+      high |= read();
+      uint32_t temp;
+      temp = read();
+      temp <<= 8;
+      temp |= read();
+      temp <<= 8;
+      temp |= read();
+      temp <<= 8;
+      temp |= read();
+      signedValue = (int32_t)temp; /* Convert */
+
+      if (high != ((signedValue < 0) ? UINT32_MAX : 0))
+      {
+        _LOG_UNPACK_ERROR_RANGE;
+        return false;
+      }
+    }
+#endif
     else
     {
       /* Can't convert this type */
@@ -791,6 +1301,31 @@ bool BERGCloudMessageBase::unpack_skip(void)
   {
     bytesToSkip = type - _MP_FIXRAW_MIN;
   }
+  else if (IN_RANGE(type, _MP_FIXEXT1, _MP_FIXEXT16))
+  {
+    /* Ext type, then 1, 2, 4, 8 or 16 bytes of data */
+    bytesToSkip = 1 + (1 << (type - _MP_FIXEXT1));
+  }
+  else if ((type == _MP_EXT8) || (type == _MP_EXT16) || (type == _MP_EXT32))
+  {
+    uint8_t sizeBytes = (type == _MP_EXT8) ? 1 : ((type == _MP_EXT16) ? 2 : 4);
+
+    if (!remaining(sizeBytes))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read 8, 16 or 32-bit unsigned integer, data size */
+    while (sizeBytes-- > 0)
+    {
+      bytesToSkip = bytesToSkip << 8;
+      bytesToSkip |= read();
+    }
+
+    /* Ext type, then the data */
+    bytesToSkip += 1;
+  }
 
   if (!remaining(bytesToSkip))
   {
@@ -808,6 +1343,215 @@ bool BERGCloudMessageBase::unpack_skip(void)
   return true;
 }
 
+bool BERGCloudMessageBase::getInteger64(void *value, bool valueIsSigned)
+{
+  /* Decode any integer type to 64 bits. This is separate from */
+  /* getInteger() so that it is only linked when it is used. */
+  uint8_t type;
+  uint8_t sizeInBytes;
+  bool typeIsSigned;
+  uint32_t high;
+  uint32_t low;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if ((type <= _MP_FIXNUM_POS_MAX) || IN_RANGE(type, _MP_FIXNUM_NEG_MIN, _MP_FIXNUM_NEG_MAX))
+  {
+    /* Fix num values are a signed 8-bit value with no type byte */
+    sizeInBytes = 0;
+    typeIsSigned = true;
+  }
+  else if ((type == _MP_UINT8) || (type == _MP_INT8))
+  {
+    sizeInBytes = 1;
+    typeIsSigned = (type == _MP_INT8);
+  }
+  else if ((type == _MP_UINT16) || (type == _MP_INT16))
+  {
+    sizeInBytes = 2;
+    typeIsSigned = (type == _MP_INT16);
+  }
+  else if ((type == _MP_UINT32) || (type == _MP_INT32))
+  {
+    sizeInBytes = 4;
+    typeIsSigned = (type == _MP_INT32);
+  }
+  else if ((type == _MP_UINT64) || (type == _MP_INT64))
+  {
+    sizeInBytes = 8;
+    typeIsSigned = (type == _MP_INT64);
+  }
+  else
+  {
+    /* Can't convert this type */
+    _LOG_UNPACK_ERROR_TYPE;
+    return false;
+  }
+
+  high = 0;
+  low = 0;
+
+  if (sizeInBytes == 0)
+  {
+    /* Read fix num value */
+    low = (uint32_t)(int32_t)(int8_t)read(); /* Convert with sign extension */
+  }
+  else
+  {
+    if (!remaining(sizeInBytes))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read type */
+    read();
+
+    /* Read value, most significant byte first */
+    while (sizeInBytes-- > 0)
+    {
+      high = (high << 8) | (low >> 24);
+      low = (low << 8) | read();
+    }
+
+    if (typeIsSigned && (type != _MP_INT64))
+    {
+      /* Convert with sign extension */
+      if (type == _MP_INT8)
+      {
+        low = (uint32_t)(int32_t)(int8_t)low;
+      }
+      else if (type == _MP_INT16)
+      {
+        low = (uint32_t)(int32_t)(int16_t)low;
+      }
+    }
+  }
+
+  if (typeIsSigned && (type != _MP_INT64))
+  {
+    /* Extend the sign into the upper half */
+    high = (low & 0x80000000) ? UINT32_MAX : 0;
+  }
+
+  /* Check range; a negative value can't be unsigned and an unsigned */
+  /* value with the top bit set can't be signed */
+  if ((high & 0x80000000) && (valueIsSigned != typeIsSigned))
+  {
+    _LOG_UNPACK_ERROR_RANGE;
+    return false;
+  }
+
+  *(uint64_t *)value = ((uint64_t)high << 32) | low;
+
+  /* Success */
+  return true;
+}
+
+bool BERGCloudMessageBase::getDouble(uint32_t *high, uint32_t *low)
+{
+  /* Read the two halves of a packed double, most significant first */
+  uint32_t data;
+  uint8_t i;
+
+  if (!remaining(sizeof(uint64_t)))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  /* Read type */
+  read();
+
+  data = 0;
+
+  for (i=0; i<sizeof(uint32_t); i++)
+  {
+    data = (data << 8) | read();
+  }
+
+  *high = data;
+
+  for (i=0; i<sizeof(uint32_t); i++)
+  {
+    data = (data << 8) | read();
+  }
+
+  *low = data;
+  return true;
+}
+
+static bool _bc_double_to_float(uint32_t high, uint32_t low, float& n)
+{
+  /* Convert the two halves of an IEEE 754 double to a float, returns */
+  /* false if the value is too large */
+  uint32_t data;
+  int16_t exponent;
+
+  if (sizeof(double) == sizeof(uint64_t))
+  {
+    double temp;
+    uint64_t temp64 = ((uint64_t)high << 32) | low;
+
+    memcpy(&temp, &temp64, sizeof(double));
+
+    /* Infinity and NaN convert as themselves */
+    if (((high & 0x7ff00000) != 0x7ff00000) && ((temp > FLT_MAX) || (temp < -FLT_MAX)))
+    {
+      return false;
+    }
+
+    n = (float)temp;
+    return true;
+  }
+
+  /* Where double is the same as float, e.g. AVR, convert the bits */
+  /* rounding to nearest; values too small for a normal float */
+  /* become zero */
+  data = high & 0x80000000;
+  exponent = (int16_t)((high >> 20) & 0x7ff);
+
+  if (exponent == 0x7ff)
+  {
+    /* Infinity or NaN */
+    data |= 0x7f800000;
+
+    if (((high & 0x000fffff) != 0) || (low != 0))
+    {
+      data |= 0x00400000;
+    }
+  }
+  else
+  {
+    exponent = exponent - 1023 + 127;
+
+    if (exponent >= 0xff)
+    {
+      return false;
+    }
+
+    if (exponent > 0)
+    {
+      data |= ((uint32_t)exponent << 23) | ((high & 0x000fffff) << 3) | (low >> 29);
+      data += (low >> 28) & 1;
+
+      if ((data & 0x7f800000) == 0x7f800000)
+      {
+        /* Rounded up out of range */
+        return false;
+      }
+    }
+  }
+
+  memcpy(&n, &data, sizeof(float));
+  return true;
+}
+
 bool BERGCloudMessageBase::unpack(uint8_t& n)
 {
   uint32_t temp;
@@ -886,6 +1630,16 @@ bool BERGCloudMessageBase::unpack(int32_t& n)
   return true;
 }
 
+bool BERGCloudMessageBase::unpack(uint64_t& n)
+{
+  return getInteger64(&n, false);
+}
+
+bool BERGCloudMessageBase::unpack(int64_t& n)
+{
+  return getInteger64(&n, true);
+}
+
 bool BERGCloudMessageBase::unpack(float& n)
 {
   /* Try to decode the next messagePack item as an 4-byte float */
@@ -901,26 +1655,109 @@ bool BERGCloudMessageBase::unpack(float& n)
 
   if (type == _MP_FLOAT)
   {
-    if (!remaining(sizeof(float)))
+    if (!remaining(sizeof(float)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read type */
+    read();
+
+    /* Read 32-bit float */
+    data = read();
+    data = data << 8;
+    data |= read();
+    data = data << 8;
+    data |= read();
+    data = data << 8;
+    data |= read();
+
+    /* Convert to float */
+    memcpy(&n, &data, sizeof(float));
+
+    /* Success */
+    return true;
+  }
+
+#ifdef BERGCLOUD_UNPACK_NARROW_64
+  if (type == _MP_DOUBLE)
+  {
+    uint32_t high;
+
+    if (!getDouble(&high, &data))
+    {
+      return false;
+    }
+
+    if (!_bc_double_to_float(high, data, n))
+    {
+      _LOG_UNPACK_ERROR_RANGE;
+      return false;
+    }
+
+    /* Success */
+    return true;
+  }
+#endif
+
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
+  return false;
+}
+
+bool BERGCloudMessageBase::unpack(double& n)
+{
+  /* Try to decode the next messagePack item as a double */
+  uint64_t data;
+  uint32_t high;
+  uint32_t low;
+  uint8_t type;
+  float temp;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if (type == _MP_FLOAT)
+  {
+    if (!unpack(temp))
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
       return false;
     }
 
-    /* Read type */
-    read();
+    n = temp;
 
-    /* Read 32-bit float */
-    data = read();
-    data = data << 8;
-    data |= read();
-    data = data << 8;
-    data |= read();
-    data = data << 8;
-    data |= read();
+    /* Success */
+    return true;
+  }
 
-    /* Convert to float */
-    memcpy(&n, &data, sizeof(float));
+  if (type == _MP_DOUBLE)
+  {
+    if (!getDouble(&high, &low))
+    {
+      return false;
+    }
+
+    if (sizeof(double) == sizeof(float))
+    {
+      /* On 8-bit AVR a double is the same as a float */
+      if (!_bc_double_to_float(high, low, temp))
+      {
+        _LOG_UNPACK_ERROR_RANGE;
+        return false;
+      }
+
+      n = temp;
+      return true;
+    }
+
+    /* Convert to double */
+    data = ((uint64_t)high << 32) | low;
+    memcpy(&n, &data, sizeof(double));
 
     /* Success */
     return true;
@@ -1171,9 +2008,10 @@ bool BERGCloudMessageBase::unpack_raw_data(uint8_t *pData, uint16_t packedSizeIn
     data = read();
     
     /* Only write up to the buffer size */
-    if (bufferSizeInBytes-- > 0)
+    if (bufferSizeInBytes > 0)
     {
       *pData++ = data;
+      bufferSizeInBytes--;
     }
   }
 
@@ -1185,6 +2023,12 @@ bool BERGCloudMessageBase::unpack(char *pString, uint32_t maxSizeInBytes)
   /* Try to decode a null-terminated C string */
   uint16_t sizeInBytes;
 
+  if (maxSizeInBytes == 0)
+  {
+    _LOG("Unpack: No space for the string.\r\n");
+    return false;
+  }
+
   if (!unpack_raw_header(&sizeInBytes))
   {
     return false;
@@ -1201,6 +2045,15 @@ bool BERGCloudMessageBase::unpack(char *pString, uint32_t maxSizeInBytes)
     return false;
   }
 
+  if (sizeInBytes >= maxSizeInBytes)
+  {
+    /* The string has been read, but is too long for the buffer; */
+    /* leave what fits null-terminated */
+    pString[maxSizeInBytes - 1] = '\0';
+    _LOG_UNPACK_ERROR_RANGE;
+    return false;
+  }
+
   /* Add null terminator */
   pString[sizeInBytes] = '\0';
 
@@ -1232,6 +2085,349 @@ bool BERGCloudMessageBase::unpack(uint8_t *pData, uint32_t maxSizeInBytes, uint3
   return unpack_raw_data(pData, sizeInBytes, maxSizeInBytes);
 }
 
+bool BERGCloudMessageBase::unpack_raw(const uint8_t *&data, uint16_t& sizeInBytes)
+{
+  /* Try to decode a block of raw data without copying it */
+  uint16_t last_read;
+
+  last_read = bytesRead;
+
+  if (!unpack_raw_header(&sizeInBytes))
+  {
+    return false;
+  }
+
+  if (!remaining(sizeInBytes))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    bytesRead = last_read;
+    return false;
+  }
+
+  data = &buffer[start + bytesRead];
+
+  /* Skip the data */
+  bytesRead += sizeInBytes;
+
+  /* Success */
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_items_header(uint16_t maxCount, uint16_t& count)
+{
+  /* Unpack an array header; nothing is read if the */
+  /* array has more than 'maxCount' items */
+  uint16_t last_read;
+
+  last_read = bytesRead;
+
+  if (!unpack_array(count))
+  {
+    return false;
+  }
+
+  if (count > maxCount)
+  {
+    _LOG("Unpack: Too many items for the array.\r\n");
+    bytesRead = last_read;
+    return false;
+  }
+
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_items(void *values, uint16_t count, uint8_t width, uint8_t type)
+{
+  /* Unpack 'count' items in bulk if they are all packed with the */
+  /* fixed-width 'type'; returns false without reading anything if not */
+  uint32_t sizeInBytes;
+
+  sizeInBytes = (uint32_t)count * (width + 1);
+
+  if ((sizeInBytes > remaining()) ||
+      !byteswap_unpack(values, &buffer[start + bytesRead], count, width, type))
+  {
+    return false;
+  }
+
+  bytesRead += sizeInBytes;
+  return true;
+}
+
+template <typename T>
+bool BERGCloudMessageBase::unpack_values(T *values, uint16_t maxCount, uint16_t& count, uint8_t type)
+{
+  /* Unpack an array of values, in bulk if they all use the */
+  /* fixed-width 'type' */
+  uint16_t i;
+
+  if (!unpack_items_header(maxCount, count))
+  {
+    return false;
+  }
+
+  if (unpack_items(values, count, sizeof(T), type))
+  {
+    return true;
+  }
+
+  /* Items were packed in other forms, unpack them one at a time */
+  for (i=0; i<count; i++)
+  {
+    if (!unpack(values[i]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_array(uint8_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_UINT8);
+}
+
+bool BERGCloudMessageBase::unpack_array(uint16_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_UINT16);
+}
+
+bool BERGCloudMessageBase::unpack_array(uint32_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_UINT32);
+}
+
+bool BERGCloudMessageBase::unpack_array(uint64_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_UINT64);
+}
+
+bool BERGCloudMessageBase::unpack_array(int8_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_INT8);
+}
+
+bool BERGCloudMessageBase::unpack_array(int16_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_INT16);
+}
+
+bool BERGCloudMessageBase::unpack_array(int32_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_INT32);
+}
+
+bool BERGCloudMessageBase::unpack_array(int64_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_INT64);
+}
+
+bool BERGCloudMessageBase::unpack_array(float *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_values(values, maxCount, count, _MP_FLOAT);
+}
+
+bool BERGCloudMessageBase::unpack_ext_header(uint8_t *extType, uint16_t *sizeInBytes)
+{
+  uint8_t type;
+  uint8_t sizeBytes;
+  uint32_t size;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if (IN_RANGE(type, _MP_FIXEXT1, _MP_FIXEXT16))
+  {
+    sizeBytes = 0;
+    size = 1 << (type - _MP_FIXEXT1);
+  }
+  else if ((type == _MP_EXT8) || (type == _MP_EXT16) || (type == _MP_EXT32))
+  {
+    sizeBytes = (type == _MP_EXT8) ? 1 : ((type == _MP_EXT16) ? 2 : 4);
+    size = 0;
+  }
+  else
+  {
+    /* Can't convert this type */
+    _LOG_UNPACK_ERROR_TYPE;
+    return false;
+  }
+
+  /* Type, size and ext type */
+  if (!remaining(1 + sizeBytes + 1))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  /* Read type */
+  read();
+
+  /* Read 8, 16 or 32-bit unsigned integer, data size */
+  while (sizeBytes-- > 0)
+  {
+    size = size << 8;
+    size |= read();
+  }
+
+  /* Read ext type */
+  *extType = read();
+
+  if (size > remaining())
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  *sizeInBytes = (uint16_t)size;
+
+  /* Success */
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(BERGCloudTypedArray& array)
+{
+  /* Try to decode a typed array without copying it */
+  uint16_t last_read;
+  uint16_t sizeInBytes;
+  uint8_t extType;
+  uint8_t elementType;
+
+  last_read = bytesRead;
+
+  if (!unpack_ext_header(&extType, &sizeInBytes))
+  {
+    bytesRead = last_read;
+    return false;
+  }
+
+  elementType = extType & (BC_TYPED_ARRAY_BIG_ENDIAN - 1);
+
+  if (((extType & ~(BC_TYPED_ARRAY_BIG_ENDIAN | (BC_TYPED_ARRAY_BIG_ENDIAN - 1))) != BC_TYPED_ARRAY_EXT_TYPE) ||
+      (elementType > BC_TYPED_ARRAY_FLOAT) || ((sizeInBytes % typedArrayWidth[elementType]) != 0))
+  {
+    /* Another ext type */
+    _LOG_UNPACK_ERROR_TYPE;
+    bytesRead = last_read;
+    return false;
+  }
+
+  array.elementType = elementType;
+  array.bigEndian = ((extType & BC_TYPED_ARRAY_BIG_ENDIAN) != 0);
+  array.width = typedArrayWidth[elementType];
+  array.count = sizeInBytes / array.width;
+  array.data = &buffer[start + bytesRead];
+
+  /* Skip the data */
+  bytesRead += sizeInBytes;
+
+  /* Success */
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_typed(void *values, uint16_t maxCount, uint16_t& count, uint8_t elementType)
+{
+  BERGCloudTypedArray array;
+  uint16_t last_read;
+  uint8_t *out = (uint8_t *)values;
+  uint16_t i;
+  uint8_t j;
+
+  last_read = bytesRead;
+
+  if (!unpack_typed_array(array))
+  {
+    return false;
+  }
+
+  if (array.elementType != elementType)
+  {
+    _LOG_UNPACK_ERROR_TYPE;
+    bytesRead = last_read;
+    return false;
+  }
+
+  if (array.count > maxCount)
+  {
+    _LOG("Unpack: Too many items for the array.\r\n");
+    bytesRead = last_read;
+    return false;
+  }
+
+  count = array.count;
+
+  if (array.bigEndian == (_BC_TYPED_ARRAY_HOST_ORDER != 0))
+  {
+    /* Same byte order as this host */
+    memcpy(out, array.data, count * array.width);
+    return true;
+  }
+
+  /* Reverse the bytes of each element */
+  for (i=0; i<count; i++)
+  {
+    for (j=0; j<array.width; j++)
+    {
+      out[j] = array.data[(array.width - 1) - j];
+    }
+
+    out += array.width;
+    array.data += array.width;
+  }
+
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(uint8_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_UINT8);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(uint16_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_UINT16);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(uint32_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_UINT32);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(uint64_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_UINT64);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(int8_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_INT8);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(int16_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_INT16);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(int32_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_INT32);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(int64_t *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_INT64);
+}
+
+bool BERGCloudMessageBase::unpack_typed_array(float *values, uint16_t maxCount, uint16_t& count)
+{
+  return unpack_typed(values, maxCount, count, BC_TYPED_ARRAY_FLOAT);
+}
+
 bool BERGCloudMessageBase::unpack_find(const char *key)
 {
   /* Search for a string key in a map; in this simple */
@@ -42,6 +42,29 @@ THE SOFTWARE.
 
 #define MAX_MAP_KEY_STRING_LENGTH (16)
 
+/* Element types of a typed array; the MessagePack ext type is */
+/* BC_TYPED_ARRAY_EXT_TYPE plus one of these, plus */
+/* BC_TYPED_ARRAY_BIG_ENDIAN if the elements are big-endian */
+#define BC_TYPED_ARRAY_UINT8       0x00
+#define BC_TYPED_ARRAY_INT8        0x01
+#define BC_TYPED_ARRAY_UINT16      0x02
+#define BC_TYPED_ARRAY_INT16       0x03
+#define BC_TYPED_ARRAY_UINT32      0x04
+#define BC_TYPED_ARRAY_INT32       0x05
+#define BC_TYPED_ARRAY_UINT64      0x06
+#define BC_TYPED_ARRAY_INT64       0x07
+#define BC_TYPED_ARRAY_FLOAT       0x08
+#define BC_TYPED_ARRAY_BIG_ENDIAN  0x10
+
+/* A typed array read in place by unpack_typed_array() */
+typedef struct {
+  uint8_t elementType;  /* BC_TYPED_ARRAY_UINT8 etc. */
+  bool bigEndian;
+  uint8_t width;        /* Bytes per element */
+  uint16_t count;
+  const uint8_t *data;  /* Points into the message and may not be aligned */
+} BERGCloudTypedArray;
+
 class BERGCloudMessageBase : public BERGCloudMessageBuffer
 {
 public:
@@ -52,6 +75,10 @@ public:
    *  Pack methods
    */
 
+  /* Pack every integer that follows in the smallest form for its */
+  /* value, rather than a form that matches the size of its type */
+  void pack_compact(bool enable = true);
+
   /* Pack an unsigned integer */
   bool pack(uint8_t n);
   bool pack(uint16_t n);
@@ -60,8 +87,13 @@ public:
   bool pack(int8_t n);
   bool pack(int16_t n);
   bool pack(int32_t n);
+  /* Pack a 64-bit integer */
+  bool pack(uint64_t n);
+  bool pack(int64_t n);
   /* Pack a float */
   bool pack(float n);
+  /* Pack a double; this packs a float where they are the same size */
+  bool pack(double n);
   /* Pack a boolean */
   bool pack(bool n);
 
@@ -76,6 +108,37 @@ public:
   bool pack(uint8_t *data, uint16_t sizeInBytes);
   /* Pack a null-terminated C string */
   bool pack(const char *string);
+  /* Pack raw data written directly into the message: write up to */
+  /* 'maxSizeInBytes' at the pointer returned, then pack_raw_end() */
+  /* with the size written. Returns NULL if there is no space. Nothing */
+  /* else may be packed in between. */
+  uint8_t *pack_raw_begin(uint16_t& maxSizeInBytes);
+  bool pack_raw_end(uint16_t sizeInBytes);
+
+  /* Pack an array of numbers; the same as pack_array(count) followed */
+  /* by pack() for each value, but with one check for space */
+  bool pack_array(const uint8_t *values, uint16_t count);
+  bool pack_array(const uint16_t *values, uint16_t count);
+  bool pack_array(const uint32_t *values, uint16_t count);
+  bool pack_array(const uint64_t *values, uint16_t count);
+  bool pack_array(const int8_t *values, uint16_t count);
+  bool pack_array(const int16_t *values, uint16_t count);
+  bool pack_array(const int32_t *values, uint16_t count);
+  bool pack_array(const int64_t *values, uint16_t count);
+  bool pack_array(const float *values, uint16_t count);
+
+  /* Pack an array of numbers as one MessagePack ext item that holds */
+  /* the values as they are in memory; smaller than pack_array(), */
+  /* but the receiver must understand BC_TYPED_ARRAY_EXT_TYPE */
+  bool pack_typed_array(const uint8_t *values, uint16_t count);
+  bool pack_typed_array(const uint16_t *values, uint16_t count);
+  bool pack_typed_array(const uint32_t *values, uint16_t count);
+  bool pack_typed_array(const uint64_t *values, uint16_t count);
+  bool pack_typed_array(const int8_t *values, uint16_t count);
+  bool pack_typed_array(const int16_t *values, uint16_t count);
+  bool pack_typed_array(const int32_t *values, uint16_t count);
+  bool pack_typed_array(const int64_t *values, uint16_t count);
+  bool pack_typed_array(const float *values, uint16_t count);
 
   /*
    *  Unpack methods
@@ -89,8 +152,13 @@ public:
   bool unpack(int8_t& n);
   bool unpack(int16_t& n);
   bool unpack(int32_t& n);
+  /* Unpack a 64-bit integer */
+  bool unpack(uint64_t& n);
+  bool unpack(int64_t& n);
   /* Unpack a float */
   bool unpack(float& n);
+  /* Unpack a double */
+  bool unpack(double& n);
   /* Unpack a boolean */
   bool unpack(bool& n);
 
@@ -129,6 +197,36 @@ public:
   bool unpack(char *string, uint32_t maxSizeInBytes);
   /* Unpack an array of data */
   bool unpack(uint8_t *data, uint32_t maxSizeInBytes, uint32_t *sizeInBytes = NULL);
+  /* Unpack an array of data without copying it; 'data' points into */
+  /* this message so is valid until it is changed */
+  bool unpack_raw(const uint8_t *&data, uint16_t& sizeInBytes);
+
+  /* Unpack an array of up to 'maxCount' numbers, 'count' is set to */
+  /* the number of items unpacked */
+  bool unpack_array(uint8_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(uint16_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(uint32_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(uint64_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(int8_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(int16_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(int32_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(int64_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_array(float *values, uint16_t maxCount, uint16_t& count);
+
+  /* Unpack a typed array of up to 'maxCount' numbers of exactly this */
+  /* type, 'count' is set to the number of items unpacked */
+  bool unpack_typed_array(uint8_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(uint16_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(uint32_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(uint64_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(int8_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(int16_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(int32_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(int64_t *values, uint16_t maxCount, uint16_t& count);
+  bool unpack_typed_array(float *values, uint16_t maxCount, uint16_t& count);
+  /* Unpack a typed array of any type without copying it; 'array' */
+  /* points into this message so is valid until it is changed */
+  bool unpack_typed_array(BERGCloudTypedArray& array);
 
 protected:
   /* Internal methods */
@@ -139,6 +237,23 @@ protected:
   bool unpack_raw_header(uint16_t *sizeInBytes);
   bool unpack_raw_data(uint8_t *data, uint16_t packedSizeInBytes, uint16_t bufferSizeInBytes);
   bool getInteger(void *value, bool valueIsSigned, int32_t min, uint32_t max);
+  bool getInteger64(void *value, bool valueIsSigned);
+  bool getDouble(uint32_t *high, uint32_t *low);
+  bool pack_integer(uint8_t type, uint32_t n, uint8_t sizeInBytes);
+  bool pack_integer64(uint8_t type, uint32_t high, uint32_t low);
+  bool pack_items(const void *values, uint16_t count, uint8_t width, uint8_t type);
+  bool unpack_items_header(uint16_t maxCount, uint16_t& count);
+  bool unpack_items(void *values, uint16_t count, uint8_t width, uint8_t type);
+  template <typename T>
+  bool pack_values(const T *values, uint16_t count, uint8_t type);
+  template <typename T>
+  bool unpack_values(T *values, uint16_t maxCount, uint16_t& count, uint8_t type);
+  bool pack_typed(const void *values, uint16_t count, uint8_t elementType);
+  bool unpack_ext_header(uint8_t *extType, uint16_t *sizeInBytes);
+  bool unpack_typed(void *values, uint16_t maxCount, uint16_t& count, uint8_t elementType);
+  bool pack_compact_unsigned(uint32_t n);
+  bool pack_compact_signed(int32_t n);
+  bool compact;
 };
 
 #endif // #ifndef BERGCLOUDMESSAGEBASE_H
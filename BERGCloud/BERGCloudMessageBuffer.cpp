@@ -33,6 +33,7 @@ BERGCloudMessageBuffer::BERGCloudMessageBuffer(void)
 
 void BERGCloudMessageBuffer::clear(void)
 {
+  start = BUFFER_HEADROOM_BYTES; /* Offset of the first byte of data */
   bytesWritten = 0; /* Number of bytes written */
   bytesRead = 0;    /* Number of bytes read */
 }
@@ -45,8 +46,8 @@ void BERGCloudMessageBuffer::restart(void)
 
 uint16_t BERGCloudMessageBuffer::size(void)
 {
-  /* Get total size of the buffer */
-  return BUFFER_SIZE_BYTES;
+  /* Get total size of the buffer, from ptr() */
+  return (BUFFER_HEADROOM_BYTES + BUFFER_SIZE_BYTES) - start;
 }
 
 uint16_t BERGCloudMessageBuffer::used(void)
@@ -64,19 +65,19 @@ void BERGCloudMessageBuffer::used(uint16_t used)
 uint16_t BERGCloudMessageBuffer::available(void)
 {
   /* Get space available in the buffer */
-  return BUFFER_SIZE_BYTES - bytesWritten;
+  return (BUFFER_HEADROOM_BYTES + BUFFER_SIZE_BYTES) - (start + bytesWritten);
 }
 
 bool BERGCloudMessageBuffer::available(uint16_t required)
 {
   /* Test if space is available for the number of bytes required */
-  return (BUFFER_SIZE_BYTES - bytesWritten) >= required;
+  return available() >= required;
 }
 
 void BERGCloudMessageBuffer::add(uint8_t data)
 {
   /* Write a byte to the buffer; no checks */
-    buffer[bytesWritten++] = data;
+    buffer[start + bytesWritten++] = data;
 }
 
 bool BERGCloudMessageBuffer::peek(uint8_t *data)
@@ -89,14 +90,14 @@ bool BERGCloudMessageBuffer::peek(uint8_t *data)
   }
 
   
-  *data = buffer[bytesRead]; /* No increment */
+  *data = buffer[start + bytesRead]; /* No increment */
   return true;
 }
 
 uint8_t BERGCloudMessageBuffer::read(void)
 {
   /* Read the next byte from the buffer; no checks */
-  return buffer[bytesRead++];
+  return buffer[start + bytesRead++];
 }
 
 uint16_t BERGCloudMessageBuffer::remaining(void)
@@ -113,5 +114,24 @@ bool BERGCloudMessageBuffer::remaining(uint16_t required)
 
 uint8_t *BERGCloudMessageBuffer::ptr(void)
 {
-  return buffer;
+  return &buffer[start];
+}
+
+uint16_t BERGCloudMessageBuffer::headroom(void)
+{
+  /* Get space available in front of the data */
+  return start;
+}
+
+void BERGCloudMessageBuffer::trim(uint16_t size)
+{
+  /* Remove bytes from the front of the data without moving the rest */
+  if (size > bytesWritten)
+  {
+    size = bytesWritten;
+  }
+
+  start += size;
+  bytesWritten -= size;
+  bytesRead = (bytesRead > size) ? (bytesRead - size) : 0;
 }
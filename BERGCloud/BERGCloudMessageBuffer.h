@@ -35,6 +35,18 @@ THE SOFTWARE.
 #define BUFFER_SIZE_BYTES 64
 #endif
 
+/* Space reserved in front of the data so that a named event header */
+/* (4 bytes, then 1 byte and the characters of the name) can be added */
+/* without copying. The default fits names of up to 31 characters, or */
+/* up to 11 on Arduino to save RAM; longer names are copied instead. */
+#ifndef BUFFER_HEADROOM_BYTES
+#ifdef ARDUINO
+#define BUFFER_HEADROOM_BYTES 16
+#else
+#define BUFFER_HEADROOM_BYTES 36
+#endif
+#endif
+
 class BERGCloudMessageBuffer
 {
 public:
@@ -57,8 +69,13 @@ public:
   bool remaining(uint16_t required);
   void restart(void);
 
+  /* Methods for the space in front of the data */
+  uint16_t headroom(void);
+  void trim(uint16_t size);
+
 protected:
-  uint8_t buffer[BUFFER_SIZE_BYTES];
+  uint8_t buffer[BUFFER_HEADROOM_BYTES + BUFFER_SIZE_BYTES];
+  uint16_t start;
   uint16_t bytesWritten;
   uint16_t bytesRead;
 };
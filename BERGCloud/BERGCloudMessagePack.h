@@ -0,0 +1,76 @@
+/*
+
+BERGCloud MessagePack type bytes
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDMESSAGEPACK_H
+#define BERGCLOUDMESSAGEPACK_H
+
+/* The first byte of each MessagePack item; shared by the message */
+/* classes, event and command names, batches and schemas */
+
+#define _MP_FIXNUM_POS_MIN  0x00
+#define _MP_FIXNUM_POS_MAX  0x7f
+#define _MP_FIXMAP_MIN      0x80
+#define _MP_FIXMAP_MAX      0x8f
+#define _MP_FIXARRAY_MIN    0x90
+#define _MP_FIXARRAY_MAX    0x9f
+#define _MP_FIXRAW_MIN      0xa0
+#define _MP_FIXRAW_MAX      0xbf
+#define _MP_NIL             0xc0
+#define _MP_BOOL_FALSE      0xc2
+#define _MP_BOOL_TRUE       0xc3
+#define _MP_EXT8            0xc7
+#define _MP_EXT16           0xc8
+#define _MP_EXT32           0xc9
+#define _MP_FLOAT           0xca
+#define _MP_DOUBLE          0xcb
+#define _MP_UINT8           0xcc
+#define _MP_UINT16          0xcd
+#define _MP_UINT32          0xce
+#define _MP_UINT64          0xcf
+#define _MP_INT8            0xd0
+#define _MP_INT16           0xd1
+#define _MP_INT32           0xd2
+#define _MP_INT64           0xd3
+#define _MP_FIXEXT1         0xd4
+#define _MP_FIXEXT2         0xd5
+#define _MP_FIXEXT4         0xd6
+#define _MP_FIXEXT8         0xd7
+#define _MP_FIXEXT16        0xd8
+#define _MP_RAW16           0xda
+#define _MP_RAW32           0xdb
+#define _MP_ARRAY16         0xdc
+#define _MP_ARRAY32         0xdd
+#define _MP_MAP16           0xde
+#define _MP_MAP32           0xdf
+#define _MP_FIXNUM_NEG_MIN  0xe0
+#define _MP_FIXNUM_NEG_MAX  0xff
+
+/* Largest size or number of items in a fix raw, array and map */
+#define _MAX_FIXRAW         (_MP_FIXRAW_MAX - _MP_FIXRAW_MIN)
+#define _MAX_FIXARRAY       (_MP_FIXARRAY_MAX - _MP_FIXARRAY_MIN)
+#define _MAX_FIXMAP         (_MP_FIXMAP_MAX - _MP_FIXMAP_MIN)
+
+#endif // #ifndef BERGCLOUDMESSAGEPACK_H
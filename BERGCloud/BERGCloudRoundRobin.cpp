@@ -0,0 +1,130 @@
+/*
+
+BERGCloud round-robin service for several shields
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudRoundRobin.h"
+
+#ifdef BERGCLOUD_ASYNC
+
+BERGCloudRoundRobin::BERGCloudRoundRobin(void)
+{
+  count = 0;
+  next = 0;
+}
+
+bool BERGCloudRoundRobin::add(BERGCloudEventOutbox& outbox)
+{
+  if (count >= BC_ROUND_ROBIN_MAX_SHIELDS)
+  {
+    return false;
+  }
+
+  outboxes[count++] = &outbox;
+  return true;
+}
+
+bool BERGCloudRoundRobin::queue(const char *eventName, const uint8_t *eventBuffer, uint16_t eventSize, uint8_t maxRetries)
+{
+  BERGCloudEventOutbox *outbox = NULL;
+  BERGCloudEventOutbox *candidate;
+  uint8_t i;
+
+  /* Use the least busy shield, preferring the next in turn */
+  for (i=0; i<count; i++)
+  {
+    candidate = outboxes[(next + i) % count];
+
+    if ((outbox == NULL) || (candidate->eventsQueued() < outbox->eventsQueued()))
+    {
+      outbox = candidate;
+    }
+  }
+
+  if (outbox == NULL)
+  {
+    return false;
+  }
+
+  return outbox->queue(eventName, eventBuffer, eventSize, maxRetries);
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudRoundRobin::queue(const char *eventName, BERGCloudMessageBuffer& buffer, uint8_t maxRetries)
+{
+  return queue(eventName, buffer.ptr(), buffer.used(), maxRetries);
+}
+#endif
+
+bool BERGCloudRoundRobin::service(void)
+{
+  BERGCloudEventOutbox *outbox;
+  bool result = true;
+  uint8_t i;
+
+  for (i=0; i<count; i++)
+  {
+    outbox = outboxes[(next + i) % count];
+
+    if (!outbox->service())
+    {
+      result = false;
+    }
+
+    if (outbox->sending())
+    {
+      /* nCS stays low on this shield until its transaction ends, so */
+      /* it keeps the bus and is serviced first next time */
+      next = (next + i) % count;
+      return result;
+    }
+  }
+
+  if (count > 0)
+  {
+    next = (next + 1) % count;
+  }
+
+  return result;
+}
+
+uint16_t BERGCloudRoundRobin::eventsQueued(void)
+{
+  uint16_t total = 0;
+  uint8_t i;
+
+  for (i=0; i<count; i++)
+  {
+    total += outboxes[i]->eventsQueued();
+  }
+
+  return total;
+}
+
+#endif // #ifdef BERGCLOUD_ASYNC
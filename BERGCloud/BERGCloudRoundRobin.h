@@ -0,0 +1,69 @@
+/*
+
+BERGCloud round-robin service for several shields
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDROUNDROBIN_H
+#define BERGCLOUDROUNDROBIN_H
+
+#include "BERGCloudEventOutbox.h"
+
+#ifdef BERGCLOUD_ASYNC
+
+/* Shares events between the outboxes of several shields and services */
+/* them in turn. Each shield is given whole transactions: interleaving */
+/* bytes of different transactions is unsafe on a shared bus, as nCS */
+/* stays low while a shield is polled for its response, so no other */
+/* outbox is serviced while one is part way through sending an event. */
+/* The SPI bus is therefore never shared within a transaction: more */
+/* shields only send more events while their radios, rather than the */
+/* bus, are the bottleneck. See examples/Linux/MultiShieldSimulator. */
+
+class BERGCloudRoundRobin
+{
+public:
+  BERGCloudRoundRobin(void);
+  /* Add the outbox of a shield; returns FALSE if there are already */
+  /* BC_ROUND_ROBIN_MAX_SHIELDS */
+  bool add(BERGCloudEventOutbox& outbox);
+  /* Queue an event on the outbox with the fewest events waiting */
+  bool queue(const char *eventName, const uint8_t *eventBuffer, uint16_t eventSize, uint8_t maxRetries = BC_OUTBOX_MAX_RETRIES);
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool queue(const char *eventName, BERGCloudMessageBuffer& buffer, uint8_t maxRetries = BC_OUTBOX_MAX_RETRIES);
+#endif
+  /* Service each outbox once, starting with a different one each */
+  /* call, until one is left part way through sending an event; */
+  /* returns FALSE if any dropped an event */
+  bool service(void);
+  /* Total events waiting to be sent */
+  uint16_t eventsQueued(void);
+private:
+  BERGCloudEventOutbox *outboxes[BC_ROUND_ROBIN_MAX_SHIELDS];
+  uint8_t count;
+  uint8_t next;
+};
+
+#endif // #ifdef BERGCLOUD_ASYNC
+
+#endif // #ifndef BERGCLOUDROUNDROBIN_H
@@ -0,0 +1,383 @@
+/*
+
+BERGCloud compile-time message schemas
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDSCHEMA_H
+#define BERGCLOUDSCHEMA_H
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memcpy() */
+
+#include "BERGCloudConfig.h"
+#include "BERGCloudConst.h"
+
+#if defined(BERGCLOUD_PACK_UNPACK) && (__cplusplus >= 201103L)
+
+#include "BERGCloudMessageBase.h"
+#include "BERGCloudMessagePack.h"
+#include "BERGCloudEventName.h"
+
+/* A message declared once as the fields of a struct, packed and     */
+/* unpacked in the order they are listed:                            */
+/*                                                                   */
+/*   struct Reading {                                                */
+/*     int16_t temperature;                                          */
+/*     uint8_t humidity;                                             */
+/*     char location[12];                                            */
+/*   };                                                              */
+/*                                                                   */
+/*   typedef BERGCloudSchema<Reading,                                */
+/*     BERGCLOUD_SCHEMA_FIELD(Reading, temperature),                 */
+/*     BERGCLOUD_SCHEMA_FIELD(Reading, humidity),                    */
+/*     BERGCLOUD_SCHEMA_FIELD(Reading, location)> ReadingSchema;     */
+/*   ...                                                             */
+/*   ReadingSchema::pack(event, reading);                            */
+/*                                                                   */
+/* The largest packed size is worked out at compile time and must    */
+/* fit in a message buffer and in an event with the longest name,    */
+/* BC_EVENT_NAME_MAX_SIZE characters, so packing checks for space    */
+/* once and then writes every field without checks. Integers         */
+/* always use the form that matches their type, even after           */
+/* pack_compact(), so that the size is known. Fields may be integers,*/
+/* float, double, bool, char arrays (null-terminated strings) and    */
+/* arrays of any of these.                                           */
+
+/* Write without checking for space */
+inline void _BC_schemaAdd16(BERGCloudMessageBase& message, uint16_t n)
+{
+  message.add((uint8_t)(n >> 8));
+  message.add((uint8_t)n);
+}
+
+inline void _BC_schemaAdd32(BERGCloudMessageBase& message, uint32_t n)
+{
+  message.add((uint8_t)(n >> 24));
+  message.add((uint8_t)(n >> 16));
+  message.add((uint8_t)(n >> 8));
+  message.add((uint8_t)n);
+}
+
+/* How a field of type T is packed and unpacked, and the most bytes */
+/* it can take; there is no definition for unsupported types */
+template <typename T>
+struct BERGCloudSchemaField;
+
+template <typename T, uint8_t type>
+struct _BC_SCHEMA_INTEGER
+{
+  static constexpr uint32_t maxSize = 1 + sizeof(T);
+
+  static void pack(BERGCloudMessageBase& message, const T& n)
+  {
+    message.add(type);
+
+    if (sizeof(T) == 1)
+    {
+      message.add((uint8_t)n);
+    }
+    else if (sizeof(T) == 2)
+    {
+      _BC_schemaAdd16(message, (uint16_t)n);
+    }
+    else if (sizeof(T) == 4)
+    {
+      _BC_schemaAdd32(message, (uint32_t)n);
+    }
+    else
+    {
+      _BC_schemaAdd32(message, (uint32_t)((uint64_t)n >> 32));
+      _BC_schemaAdd32(message, (uint32_t)n);
+    }
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, T& n)
+  {
+    return message.unpack(n);
+  }
+};
+
+template <> struct BERGCloudSchemaField<uint8_t> : _BC_SCHEMA_INTEGER<uint8_t, _MP_UINT8> {};
+template <> struct BERGCloudSchemaField<uint16_t> : _BC_SCHEMA_INTEGER<uint16_t, _MP_UINT16> {};
+template <> struct BERGCloudSchemaField<uint32_t> : _BC_SCHEMA_INTEGER<uint32_t, _MP_UINT32> {};
+template <> struct BERGCloudSchemaField<uint64_t> : _BC_SCHEMA_INTEGER<uint64_t, _MP_UINT64> {};
+template <> struct BERGCloudSchemaField<int8_t> : _BC_SCHEMA_INTEGER<int8_t, _MP_INT8> {};
+template <> struct BERGCloudSchemaField<int16_t> : _BC_SCHEMA_INTEGER<int16_t, _MP_INT16> {};
+template <> struct BERGCloudSchemaField<int32_t> : _BC_SCHEMA_INTEGER<int32_t, _MP_INT32> {};
+template <> struct BERGCloudSchemaField<int64_t> : _BC_SCHEMA_INTEGER<int64_t, _MP_INT64> {};
+
+template <>
+struct BERGCloudSchemaField<bool>
+{
+  static constexpr uint32_t maxSize = 1;
+
+  static void pack(BERGCloudMessageBase& message, const bool& n)
+  {
+    message.add(n ? _MP_BOOL_TRUE : _MP_BOOL_FALSE);
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, bool& n)
+  {
+    return message.unpack(n);
+  }
+};
+
+template <>
+struct BERGCloudSchemaField<float>
+{
+  static constexpr uint32_t maxSize = 1 + sizeof(uint32_t);
+
+  static void pack(BERGCloudMessageBase& message, const float& n)
+  {
+    uint32_t data;
+
+    memcpy(&data, &n, sizeof(float));
+    message.add(_MP_FLOAT);
+    _BC_schemaAdd32(message, data);
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, float& n)
+  {
+    return message.unpack(n);
+  }
+};
+
+template <>
+struct BERGCloudSchemaField<double>
+{
+  /* On 8-bit AVR a double is the same as a float */
+  static constexpr uint32_t maxSize = 1 + sizeof(double);
+
+  static void pack(BERGCloudMessageBase& message, const double& n)
+  {
+    uint64_t data = 0;
+
+    if (sizeof(double) == sizeof(float))
+    {
+      BERGCloudSchemaField<float>::pack(message, (float)n);
+      return;
+    }
+
+    memcpy(&data, &n, sizeof(double));
+    message.add(_MP_DOUBLE);
+    _BC_schemaAdd32(message, (uint32_t)(data >> 32));
+    _BC_schemaAdd32(message, (uint32_t)data);
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, double& n)
+  {
+    return message.unpack(n);
+  }
+};
+
+/* A null-terminated string of up to N-1 characters */
+template <size_t N>
+struct BERGCloudSchemaField<char[N]>
+{
+  static_assert(N > 0, "String field must have space for a null terminator");
+  static_assert((N - 1) <= UINT16_MAX, "String field is too long");
+
+  static constexpr uint32_t maxSize = (((N - 1) <= _MAX_FIXRAW) ? 1 : 1 + sizeof(uint16_t)) + (N - 1);
+
+  static void pack(BERGCloudMessageBase& message, const char (&s)[N])
+  {
+    uint16_t size = 0;
+    uint16_t i;
+
+    while ((size < (N - 1)) && (s[size] != '\0'))
+    {
+      size++;
+    }
+
+    if (size <= _MAX_FIXRAW)
+    {
+      message.add(_MP_FIXRAW_MIN + size);
+    }
+    else
+    {
+      message.add(_MP_RAW16);
+      _BC_schemaAdd16(message, size);
+    }
+
+    for (i=0; i<size; i++)
+    {
+      message.add((uint8_t)s[i]);
+    }
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, char (&s)[N])
+  {
+    return message.unpack(s, N);
+  }
+};
+
+/* An array of exactly N items */
+template <typename T, size_t N>
+struct BERGCloudSchemaField<T[N]>
+{
+  static_assert(N <= UINT16_MAX, "Array field is too long");
+
+  static constexpr uint32_t maxSize = ((N <= _MAX_FIXARRAY) ? 1 : 1 + sizeof(uint16_t)) +
+    (N * BERGCloudSchemaField<T>::maxSize);
+
+  static void pack(BERGCloudMessageBase& message, const T (&values)[N])
+  {
+    size_t i;
+
+    if (N <= _MAX_FIXARRAY)
+    {
+      message.add(_MP_FIXARRAY_MIN + N);
+    }
+    else
+    {
+      message.add(_MP_ARRAY16);
+      _BC_schemaAdd16(message, N);
+    }
+
+    for (i=0; i<N; i++)
+    {
+      BERGCloudSchemaField<T>::pack(message, values[i]);
+    }
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, T (&values)[N])
+  {
+    uint16_t items;
+    size_t i;
+
+    if (!message.unpack_array(items) || (items != N))
+    {
+      return false;
+    }
+
+    for (i=0; i<N; i++)
+    {
+      if (!BERGCloudSchemaField<T>::unpack(message, values[i]))
+      {
+        return false;
+      }
+    }
+
+    return true;
+  }
+};
+
+/* A member of struct S, see BERGCLOUD_SCHEMA_FIELD() */
+template <typename S, typename T, T S::*member>
+struct BERGCloudSchemaMember
+{
+  static constexpr uint32_t maxSize = BERGCloudSchemaField<T>::maxSize;
+
+  static void pack(BERGCloudMessageBase& message, const S& s)
+  {
+    BERGCloudSchemaField<T>::pack(message, s.*member);
+  }
+
+  static bool unpack(BERGCloudMessageBase& message, S& s)
+  {
+    return BERGCloudSchemaField<T>::unpack(message, s.*member);
+  }
+};
+
+#define BERGCLOUD_SCHEMA_FIELD(type, member) \
+  BERGCloudSchemaMember<type, decltype(type::member), &type::member>
+
+/* Expands to one call per field */
+template <typename... F>
+struct _BC_SCHEMA_FIELDS;
+
+template <>
+struct _BC_SCHEMA_FIELDS<>
+{
+  static constexpr uint32_t maxSize = 0;
+
+  template <typename S>
+  static void pack(BERGCloudMessageBase&, const S&)
+  {
+  }
+
+  template <typename S>
+  static bool unpack(BERGCloudMessageBase&, S&)
+  {
+    return true;
+  }
+};
+
+template <typename F, typename... R>
+struct _BC_SCHEMA_FIELDS<F, R...>
+{
+  static constexpr uint32_t maxSize = F::maxSize + _BC_SCHEMA_FIELDS<R...>::maxSize;
+
+  template <typename S>
+  static void pack(BERGCloudMessageBase& message, const S& s)
+  {
+    F::pack(message, s);
+    _BC_SCHEMA_FIELDS<R...>::pack(message, s);
+  }
+
+  template <typename S>
+  static bool unpack(BERGCloudMessageBase& message, S& s)
+  {
+    return F::unpack(message, s) && _BC_SCHEMA_FIELDS<R...>::unpack(message, s);
+  }
+};
+
+template <typename S, typename... F>
+struct BERGCloudSchema
+{
+  /* Most bytes the fields can take when packed */
+  static constexpr uint32_t maxSize = _BC_SCHEMA_FIELDS<F...>::maxSize;
+
+  static_assert(sizeof...(F) > 0, "Schema has no fields");
+  static_assert(maxSize <= BUFFER_SIZE_BYTES, "Schema does not fit in BUFFER_SIZE_BYTES");
+  /* +1 for the messagePack fixraw byte before the event name */
+  static_assert(maxSize <= (SPI_MAX_PAYLOAD_SIZE_BYTES - (SPI_EVENT_HEADER_SIZE_BYTES + 1 + BC_EVENT_NAME_MAX_SIZE)),
+    "Schema does not fit in an event");
+
+  /* Pack every field; returns FALSE without packing anything if the */
+  /* message already holds too much data */
+  static bool pack(BERGCloudMessageBase& message, const S& s)
+  {
+    if (!message.available(maxSize))
+    {
+      _LOG_PACK_ERROR_NO_SPACE;
+      return false;
+    }
+
+    _BC_SCHEMA_FIELDS<F...>::pack(message, s);
+    return true;
+  }
+
+  /* Unpack every field; returns FALSE at the first that fails */
+  static bool unpack(BERGCloudMessageBase& message, S& s)
+  {
+    return _BC_SCHEMA_FIELDS<F...>::unpack(message, s);
+  }
+};
+
+#endif // #if defined(BERGCLOUD_PACK_UNPACK) && (__cplusplus >= 201103L)
+
+#endif // #ifndef BERGCLOUDSCHEMA_H
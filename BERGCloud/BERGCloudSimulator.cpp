@@ -0,0 +1,551 @@
+/*
+
+BERGCloud Devshield simulator
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#ifdef LINUX
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memcpy() */
+
+#include "BERGCloudSimulator.h"
+#include "BERGCloudCRC16.h"
+#include "BERGCloudMessagePack.h"
+
+/* Shield protocol states */
+#define _SIM_STATE_RESET      0 /* Send SPI_PROTOCOL_RESET on the next byte */
+#define _SIM_STATE_IDLE       1 /* Waiting for a request */
+#define _SIM_STATE_REQUEST    2 /* Receiving header, data and footer */
+#define _SIM_STATE_WAIT       3 /* Processing; send SPI_PROTOCOL_PENDING */
+#define _SIM_STATE_RESPONSE   4 /* Sending header, data and footer */
+
+static const BERGCloudSimulatorConfig defaultConfig = {
+  2,    /* byteTime_uS; 4MHz SPI clock */
+  1,    /* timerReadTime_uS */
+  1000, /* responseLatency_uS */
+  0,    /* eventSendTime_mS */
+  1000, /* joinTime_mS */
+  4,    /* commandQueueDepth */
+  4     /* eventQueueDepth */
+};
+
+static const uint8_t simClaimcode[BC_CLAIMCODE_SIZE_BYTES] = "SIMU-LATE-DSHD-0000";
+
+BERGCloudSimulator::BERGCloudSimulator(void)
+{
+  config = defaultConfig;
+  now_uS = 0;
+  resetTime = 0;
+  resetShield();
+}
+
+bool BERGCloudSimulator::begin(const BERGCloudSimulatorConfig *_config)
+{
+  /* Call base class method */
+  BERGCloudBase::begin();
+
+  config = (_config != NULL) ? *_config : defaultConfig;
+
+  if ((config.commandQueueDepth == 0) || (config.commandQueueDepth > BC_SIM_MAX_QUEUE_DEPTH) ||
+      (config.eventQueueDepth == 0) || (config.eventQueueDepth > BC_SIM_MAX_QUEUE_DEPTH))
+  {
+    _LOG("Invalid queue depth (BERGCloudSimulator::begin)\r\n");
+    return false;
+  }
+
+  resetShield();
+  return true;
+}
+
+void BERGCloudSimulator::end()
+{
+  /* Call base class method */
+  BERGCloudBase::end();
+}
+
+void BERGCloudSimulator::resetShield(void)
+{
+  state = _SIM_STATE_RESET;
+  requestSize = 0;
+  responseSize = 0;
+  responseIndex = 0;
+  connectState = BC_CONNECT_STATE_DISCONNECTED;
+  responseTime_uS = now_uS;
+  connectTime_uS = now_uS;
+  eventTime_uS = now_uS;
+
+  commands.depth = config.commandQueueDepth;
+  commands.head = 0;
+  commands.count = 0;
+  events.depth = config.eventQueueDepth;
+  events.head = 0;
+  events.count = 0;
+
+  bytesClocked = 0;
+  transfers = 0;
+  eventsSent = 0;
+  requestCRCErrors = 0;
+}
+
+uint16_t BERGCloudSimulator::SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS)
+{
+  uint16_t i;
+
+  if ( (dataOut == NULL) || (dataIn == NULL) )
+  {
+    _LOG("Invalid parameter (BERGCloudSimulator::SPITransaction)\r\n");
+    return 0;
+  }
+
+  transfers++;
+
+  for (i = 0; i < dataSize; i++)
+  {
+    dataIn[i] = shieldByte(dataOut[i]);
+  }
+
+  if (finalCS)
+  {
+    SPIDeselect();
+  }
+
+  return dataSize;
+}
+
+void BERGCloudSimulator::SPIDeselect(void)
+{
+  /* nCS high ends any request or response in progress */
+  if (state != _SIM_STATE_RESET)
+  {
+    state = _SIM_STATE_IDLE;
+  }
+}
+
+uint8_t BERGCloudSimulator::shieldByte(uint8_t dataIn)
+{
+  uint8_t dataOut;
+
+  now_uS += config.byteTime_uS;
+  bytesClocked++;
+  updateNetwork();
+
+  switch (state)
+  {
+    case _SIM_STATE_RESET:
+      state = _SIM_STATE_IDLE;
+      return SPI_PROTOCOL_RESET;
+
+    case _SIM_STATE_IDLE:
+      if (dataIn == SPI_PROTOCOL_PAD)
+      {
+        /* Resynchronisation */
+        return SPI_PROTOCOL_RESET;
+      }
+
+      /* Start of a request */
+      request[0] = dataIn;
+      requestSize = 1;
+      state = _SIM_STATE_REQUEST;
+      return SPI_PROTOCOL_PAD;
+
+    case _SIM_STATE_REQUEST:
+      request[requestSize++] = dataIn;
+
+      if ((requestSize == SPI_HEADER_SIZE_BYTES) && (request[3] > SPI_MAX_PAYLOAD_SIZE_BYTES))
+      {
+        /* Invalid header */
+        state = _SIM_STATE_IDLE;
+        return SPI_PROTOCOL_RESET;
+      }
+
+      if ((requestSize > SPI_HEADER_SIZE_BYTES) &&
+          (requestSize == (SPI_HEADER_SIZE_BYTES + request[3] + SPI_FOOTER_SIZE_BYTES)))
+      {
+        process();
+      }
+
+      return SPI_PROTOCOL_PAD;
+
+    case _SIM_STATE_WAIT:
+      if (now_uS < responseTime_uS)
+      {
+        return SPI_PROTOCOL_PENDING;
+      }
+
+      state = _SIM_STATE_RESPONSE;
+      /* Fall through */
+
+    case _SIM_STATE_RESPONSE:
+      dataOut = response[responseIndex++];
+
+      if (responseIndex >= responseSize)
+      {
+        state = _SIM_STATE_IDLE;
+      }
+
+      return dataOut;
+
+    default:
+      break;
+  }
+
+  return SPI_PROTOCOL_PAD;
+}
+
+void BERGCloudSimulator::process(void)
+{
+  uint16_t dataCRC;
+  uint16_t calcCRC;
+  uint8_t dataSize = request[3];
+  uint8_t *data = &request[SPI_HEADER_SIZE_BYTES];
+  uint8_t temp[BC_EUI64_SIZE_BYTES];
+  _BC_SIM_QUEUE_ENTRY *entry;
+  uint8_t i;
+
+  /* Check CRC */
+  calcCRC = crc16(request, SPI_HEADER_SIZE_BYTES + dataSize, 0xffff);
+  dataCRC = request[SPI_HEADER_SIZE_BYTES + dataSize];
+  dataCRC <<= 8;
+  dataCRC |= request[SPI_HEADER_SIZE_BYTES + dataSize + 1];
+
+  if (calcCRC != dataCRC)
+  {
+    /* Reset; the host sees this while polling for the response */
+    requestCRCErrors++;
+    state = _SIM_STATE_RESET;
+    return;
+  }
+
+  switch (request[0])
+  {
+    case SPI_CMD_GET_CONNECT_STATE:
+      respond(SPI_RSP_SUCCESS, &connectState, sizeof(connectState));
+      break;
+
+    case SPI_CMD_GET_CLAIMCODE:
+      respond(SPI_RSP_SUCCESS, simClaimcode, sizeof(simClaimcode));
+      break;
+
+    case SPI_CMD_GET_CLAIM_STATE:
+      temp[0] = BC_CLAIM_STATE_NOT_CLAIMED;
+      respond(SPI_RSP_SUCCESS, temp, 1);
+      break;
+
+    case SPI_CMD_GET_SIGNAL_QUALITY:
+      temp[0] = (uint8_t)-60; /* RSSI */
+      temp[1] = 200;          /* LQI */
+      respond(SPI_RSP_SUCCESS, temp, 2);
+      break;
+
+    case SPI_CMD_GET_EUI64:
+      if ((dataSize != 1) || (data[0] > BC_EUI64_COORDINATOR))
+      {
+        respond(SPI_RSP_INVALID_COMMAND, NULL, 0);
+        break;
+      }
+
+      for (i=0; i<sizeof(temp); i++)
+      {
+        temp[i] = (data[0] << 4) | i;
+      }
+
+      respond(SPI_RSP_SUCCESS, temp, sizeof(temp));
+      break;
+
+    case SPI_CMD_GET_ADDRESS:
+      for (i=0; i<sizeof(temp); i++)
+      {
+        temp[i] = 0xa0 | i;
+      }
+
+      respond(SPI_RSP_SUCCESS, temp, sizeof(temp));
+      break;
+
+    case SPI_CMD_SEND_ANNOUNCE:
+      if (dataSize != (BC_KEY_SIZE_BYTES + 4))
+      {
+        respond(SPI_RSP_INVALID_COMMAND, NULL, 0);
+        break;
+      }
+
+      connectState = BC_CONNECT_STATE_CONNECTING;
+      connectTime_uS = now_uS + ((uint64_t)config.joinTime_mS * 1000);
+      respond(SPI_RSP_SUCCESS, NULL, 0);
+      break;
+
+    case SPI_CMD_POLL_FOR_COMMAND:
+      entry = queuePeek(&commands);
+
+      if (entry == NULL)
+      {
+        respond(SPI_RSP_NO_DATA, NULL, 0);
+        break;
+      }
+
+      respond(SPI_RSP_SUCCESS, entry->data, entry->size);
+      queueRemove(&commands);
+      break;
+
+    case SPI_CMD_SET_DISPLAY_STYLE:
+    case SPI_CMD_DISPLAY_PRINT:
+      respond(SPI_RSP_SUCCESS, NULL, 0);
+      break;
+
+    case SPI_CMD_SEND_EVENT_RAW:
+    case SPI_CMD_SEND_EVENT_PACKED:
+      if (connectState == BC_CONNECT_STATE_DISCONNECTED)
+      {
+        respond(SPI_RSP_SEND_FAILED, NULL, 0);
+        break;
+      }
+
+      if (connectState == BC_CONNECT_STATE_CONNECTING)
+      {
+        respond(SPI_RSP_BUSY, NULL, 0);
+        break;
+      }
+
+      if (events.count == 0)
+      {
+        /* Radio starts sending this event now */
+        eventTime_uS = now_uS + ((uint64_t)config.eventSendTime_mS * 1000);
+      }
+
+      if (!queuePut(&events, data, dataSize))
+      {
+        respond(SPI_RSP_NO_FREE_BUFFERS, NULL, 0);
+        break;
+      }
+
+      respond(SPI_RSP_SUCCESS, NULL, 0);
+      break;
+
+    default:
+      respond(SPI_RSP_INVALID_COMMAND, NULL, 0);
+      break;
+  }
+}
+
+void BERGCloudSimulator::respond(uint8_t rsp, const uint8_t *data, uint16_t dataSize)
+{
+  uint16_t calcCRC;
+
+  /* Create header */
+  response[0] = rsp;
+  response[1] = 0x00; /* Reserved */
+  response[2] = 0x00; /* Reserved */
+  response[3] = dataSize;
+  responseSize = SPI_HEADER_SIZE_BYTES;
+
+  /* Add data */
+  if (dataSize > 0)
+  {
+    memcpy(&response[responseSize], data, dataSize);
+    responseSize += dataSize;
+  }
+
+  /* Add footer */
+  calcCRC = crc16(response, responseSize, 0xffff);
+  response[responseSize++] = calcCRC >> 8;
+  response[responseSize++] = calcCRC & 0xff;
+
+  responseIndex = 0;
+  responseTime_uS = now_uS + config.responseLatency_uS;
+  state = _SIM_STATE_WAIT;
+}
+
+void BERGCloudSimulator::updateNetwork(void)
+{
+  if ((connectState == BC_CONNECT_STATE_CONNECTING) && (now_uS >= connectTime_uS))
+  {
+    connectState = BC_CONNECT_STATE_CONNECTED;
+  }
+
+  if (config.eventSendTime_mS == 0)
+  {
+    /* Events stay queued until taken */
+    return;
+  }
+
+  while ((events.count > 0) && (now_uS >= eventTime_uS))
+  {
+    queueRemove(&events);
+    eventsSent++;
+    eventTime_uS += (uint64_t)config.eventSendTime_mS * 1000;
+  }
+}
+
+bool BERGCloudSimulator::queueCommand(const char *commandName, const uint8_t *data, uint16_t dataSize)
+{
+  uint8_t entry[SPI_MAX_PAYLOAD_SIZE_BYTES];
+  uint16_t nameSize;
+  uint16_t entrySize;
+
+  if ((commandName == NULL) || ((data == NULL) && (dataSize > 0)))
+  {
+    return false;
+  }
+
+  nameSize = strlen(commandName);
+
+  if ((nameSize == 0) || (nameSize > _MAX_FIXRAW) ||
+      ((2 + 1 + nameSize + dataSize) > SPI_MAX_PAYLOAD_SIZE_BYTES))
+  {
+    _LOG("Command is too big (BERGCloudSimulator::queueCommand)\r\n");
+    return false;
+  }
+
+  /* Command ID, then the name as a messagePack fixraw, then the data */
+  entry[0] = BC_COMMAND_NAMED_PACKED >> 8;
+  entry[1] = BC_COMMAND_NAMED_PACKED & 0xff;
+  entry[2] = _MP_FIXRAW_MIN + nameSize;
+  memcpy(&entry[3], commandName, nameSize);
+  entrySize = 3 + nameSize;
+
+  if (dataSize > 0)
+  {
+    memcpy(&entry[entrySize], data, dataSize);
+    entrySize += dataSize;
+  }
+
+  return queuePut(&commands, entry, entrySize);
+}
+
+bool BERGCloudSimulator::takeEvent(uint8_t *eventBuffer, uint16_t eventBufferSize, uint16_t& eventSize)
+{
+  _BC_SIM_QUEUE_ENTRY *entry = queuePeek(&events);
+
+  if ((entry == NULL) || (eventBuffer == NULL) || (entry->size > eventBufferSize))
+  {
+    eventSize = 0;
+    return false;
+  }
+
+  memcpy(eventBuffer, entry->data, entry->size);
+  eventSize = entry->size;
+  queueRemove(&events);
+  eventsSent++;
+
+  if (events.count > 0)
+  {
+    eventTime_uS = now_uS + ((uint64_t)config.eventSendTime_mS * 1000);
+  }
+
+  return true;
+}
+
+uint8_t BERGCloudSimulator::commandsQueued(void)
+{
+  return commands.count;
+}
+
+uint8_t BERGCloudSimulator::eventsQueued(void)
+{
+  return events.count;
+}
+
+void BERGCloudSimulator::setConnectionState(uint8_t _state)
+{
+  connectState = _state;
+}
+
+void BERGCloudSimulator::advanceTime_uS(uint32_t time_uS)
+{
+  now_uS += time_uS;
+  updateNetwork();
+}
+
+bool BERGCloudSimulator::queuePut(_BC_SIM_QUEUE *queue, const uint8_t *data, uint16_t dataSize)
+{
+  _BC_SIM_QUEUE_ENTRY *entry;
+
+  if ((queue->count >= queue->depth) || (dataSize > sizeof(entry->data)))
+  {
+    return false;
+  }
+
+  entry = &queue->entry[(queue->head + queue->count) % queue->depth];
+  memcpy(entry->data, data, dataSize);
+  entry->size = dataSize;
+  queue->count++;
+  return true;
+}
+
+_BC_SIM_QUEUE_ENTRY *BERGCloudSimulator::queuePeek(_BC_SIM_QUEUE *queue)
+{
+  if (queue->count == 0)
+  {
+    return NULL;
+  }
+
+  return &queue->entry[queue->head];
+}
+
+void BERGCloudSimulator::queueRemove(_BC_SIM_QUEUE *queue)
+{
+  if (queue->count > 0)
+  {
+    queue->head = (queue->head + 1) % queue->depth;
+    queue->count--;
+  }
+}
+
+void BERGCloudSimulator::timerReset(void)
+{
+  /* Doesn't count as a timer read */
+  resetTime = (uint32_t)(now_uS / 1000);
+}
+
+uint32_t BERGCloudSimulator::timerRead_mS(void)
+{
+  return timerNow_mS() - resetTime;
+}
+
+uint32_t BERGCloudSimulator::timerNow_mS(void)
+{
+  now_uS += config.timerReadTime_uS;
+  updateNetwork();
+  return (uint32_t)(now_uS / 1000);
+}
+
+void BERGCloudSimulator::timerWait_uS(uint32_t time_uS)
+{
+  advanceTime_uS(time_uS);
+}
+
+uint32_t BERGCloudSimulator::timerNow_uS(void)
+{
+  now_uS += config.timerReadTime_uS;
+  updateNetwork();
+  return (uint32_t)now_uS;
+}
+
+uint16_t BERGCloudSimulator::getHostType(void)
+{
+  return BC_HOST_LINUX;
+}
+
+#endif // #ifdef LINUX
@@ -0,0 +1,123 @@
+/*
+
+BERGCloud Devshield simulator
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDSIMULATOR_H
+#define BERGCLOUDSIMULATOR_H
+
+#include "BERGCloudBase.h"
+
+/* Maximum queue depth for commands and events */
+#ifndef BC_SIM_MAX_QUEUE_DEPTH
+#define BC_SIM_MAX_QUEUE_DEPTH 16
+#endif
+
+typedef struct {
+  /* Virtual time taken to clock one byte over SPI */
+  uint32_t byteTime_uS;
+  /* Virtual time taken by each read of the timer */
+  uint32_t timerReadTime_uS;
+  /* Time from the end of a request until the response is ready; */
+  /* the shield returns SPI_PROTOCOL_PENDING until then */
+  uint32_t responseLatency_uS;
+  /* Time taken to send one queued event over the radio; */
+  /* zero leaves events queued until they are taken */
+  uint32_t eventSendTime_mS;
+  /* Time from SPI_CMD_SEND_ANNOUNCE until connected */
+  uint32_t joinTime_mS;
+  /* Queue depths, up to BC_SIM_MAX_QUEUE_DEPTH */
+  uint8_t commandQueueDepth;
+  uint8_t eventQueueDepth;
+} BERGCloudSimulatorConfig;
+
+typedef struct {
+  uint16_t size;
+  uint8_t data[SPI_MAX_PAYLOAD_SIZE_BYTES];
+} _BC_SIM_QUEUE_ENTRY;
+
+typedef struct {
+  _BC_SIM_QUEUE_ENTRY entry[BC_SIM_MAX_QUEUE_DEPTH];
+  uint8_t depth;
+  uint8_t head;
+  uint8_t count;
+} _BC_SIM_QUEUE;
+
+class BERGCloudSimulator : public BERGCloudBase
+{
+public:
+  BERGCloudSimulator(void);
+  bool begin(const BERGCloudSimulatorConfig *config = NULL);
+  void end();
+  /* Queue a named command for the host to poll for */
+  bool queueCommand(const char *commandName, const uint8_t *data, uint16_t dataSize);
+  /* Take the oldest event sent by the host */
+  bool takeEvent(uint8_t *eventBuffer, uint16_t eventBufferSize, uint16_t& eventSize);
+  uint8_t commandsQueued(void);
+  uint8_t eventsQueued(void);
+  /* Set the network connection state */
+  void setConnectionState(uint8_t state);
+  /* Advance the virtual clock */
+  void advanceTime_uS(uint32_t time_uS);
+  /* Reset the shield side of the protocol */
+  void resetShield(void);
+  /* Counters */
+  uint32_t bytesClocked;
+  uint32_t transfers;
+  uint32_t eventsSent;
+  uint32_t requestCRCErrors;
+private:
+  uint16_t SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS);
+  void SPIDeselect(void);
+  uint16_t getHostType(void);
+  void timerReset(void);
+  uint32_t timerRead_mS(void);
+  uint32_t timerNow_mS(void);
+  uint32_t timerNow_uS(void);
+  void timerWait_uS(uint32_t time_uS);
+  uint8_t shieldByte(uint8_t dataIn);
+  void process(void);
+  void respond(uint8_t response, const uint8_t *data, uint16_t dataSize);
+  void updateNetwork(void);
+  bool queuePut(_BC_SIM_QUEUE *queue, const uint8_t *data, uint16_t dataSize);
+  _BC_SIM_QUEUE_ENTRY *queuePeek(_BC_SIM_QUEUE *queue);
+  void queueRemove(_BC_SIM_QUEUE *queue);
+  BERGCloudSimulatorConfig config;
+  uint8_t state;
+  uint8_t request[SPI_MAX_PACKET_SIZE_BYTES];
+  uint16_t requestSize;
+  uint8_t response[SPI_MAX_PACKET_SIZE_BYTES];
+  uint16_t responseSize;
+  uint16_t responseIndex;
+  uint8_t connectState;
+  uint64_t now_uS;
+  uint32_t resetTime;
+  uint64_t responseTime_uS;
+  uint64_t connectTime_uS;
+  uint64_t eventTime_uS;
+  _BC_SIM_QUEUE commands;
+  _BC_SIM_QUEUE events;
+};
+
+#endif // #ifndef BERGCLOUDSIMULATOR_H
@@ -0,0 +1,407 @@
+/*
+
+BERGCloud time series encoding
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudTimeSeries.h"
+
+#ifdef BERGCLOUD_PACK_UNPACK
+
+
+static uint32_t zigzag(int32_t n)
+{
+  /* Map signed to unsigned so that small changes either way are small */
+  return ((uint32_t)n << 1) ^ ((uint32_t)0 - ((uint32_t)n >> 31));
+}
+
+static int32_t unzigzag(uint32_t n)
+{
+  return (int32_t)((n >> 1) ^ ((uint32_t)0 - (n & 1)));
+}
+
+static uint8_t varintSize(uint32_t n)
+{
+  uint8_t size = 1;
+
+  while (n >= 0x80)
+  {
+    n >>= 7;
+    size++;
+  }
+
+  return size;
+}
+
+static uint8_t putVarint(uint8_t *out, uint32_t n)
+{
+  /* 7 bits per byte, least significant first; the top bit is set */
+  /* if more bytes follow */
+  uint8_t size = 0;
+
+  while (n >= 0x80)
+  {
+    out[size++] = (uint8_t)n | 0x80;
+    n >>= 7;
+  }
+
+  out[size++] = (uint8_t)n;
+  return size;
+}
+
+static uint8_t changeSize(uint32_t n)
+{
+  /* A change has 6 bits in its first byte */
+  return (n < 0x40) ? 1 : 1 + varintSize(n >> 6);
+}
+
+static uint8_t putChange(uint8_t *out, uint32_t n, bool run)
+{
+  out[0] = (uint8_t)((n & 0x3f) << 1) | (run ? 0x01 : 0x00);
+
+  if (n < 0x40)
+  {
+    return 1;
+  }
+
+  out[0] |= 0x80;
+  return 1 + putVarint(&out[1], n >> 6);
+}
+
+/*
+ * Encoder
+ */
+
+BERGCloudTimeSeriesEncoder::BERGCloudTimeSeriesEncoder(void)
+{
+  begin(NULL, 0);
+}
+
+void BERGCloudTimeSeriesEncoder::begin(uint8_t *buffer, uint16_t size)
+{
+  message = NULL;
+  out = buffer;
+  this->size = (buffer != NULL) ? size : 0;
+  used = 0;
+  samples = 0;
+  last = 0;
+  runDelta = 0;
+  runLength = 0;
+}
+
+bool BERGCloudTimeSeriesEncoder::begin(BERGCloudMessageBase& message)
+{
+  uint8_t *data;
+  uint16_t sizeInBytes;
+
+  data = message.pack_raw_begin(sizeInBytes);
+  begin(data, sizeInBytes);
+
+  if (data == NULL)
+  {
+    return false;
+  }
+
+  this->message = &message;
+  return true;
+}
+
+uint8_t BERGCloudTimeSeriesEncoder::flushSize(void)
+{
+  /* Space needed to write the current run */
+  if (runLength == 0)
+  {
+    return 0;
+  }
+
+  return changeSize(zigzag((int32_t)runDelta)) + ((runLength > 1) ? varintSize(runLength - 2) : 0);
+}
+
+void BERGCloudTimeSeriesEncoder::flush(void)
+{
+  /* Write the current run; there must be space */
+  if (runLength == 0)
+  {
+    return;
+  }
+
+  used += putChange(&out[used], zigzag((int32_t)runDelta), runLength > 1);
+
+  if (runLength > 1)
+  {
+    used += putVarint(&out[used], runLength - 2);
+  }
+
+  runLength = 0;
+}
+
+bool BERGCloudTimeSeriesEncoder::add(int32_t sample)
+{
+  uint32_t delta;
+
+  if (samples == UINT16_MAX)
+  {
+    _LOG("Too many samples (BERGCloudTimeSeriesEncoder::add)\r\n");
+    return false;
+  }
+
+  if (samples == 0)
+  {
+    /* The first sample is written as it is */
+    if ((used + varintSize(zigzag(sample))) > size)
+    {
+      _LOG_PACK_ERROR_NO_SPACE;
+      return false;
+    }
+
+    used += putVarint(&out[used], zigzag(sample));
+  }
+  else
+  {
+    /* Wraps around, so that any change can be coded */
+    delta = (uint32_t)sample - (uint32_t)last;
+
+    if ((runLength > 0) && (delta == runDelta))
+    {
+      /* Extend the run if it still fits */
+      runLength++;
+
+      if ((used + flushSize()) > size)
+      {
+        runLength--;
+        _LOG_PACK_ERROR_NO_SPACE;
+        return false;
+      }
+    }
+    else
+    {
+      /* Start a new run; space is checked for the current run and */
+      /* the new one so that end() can always write the last run */
+      if ((used + flushSize() + changeSize(zigzag((int32_t)delta))) > size)
+      {
+        _LOG_PACK_ERROR_NO_SPACE;
+        return false;
+      }
+
+      flush();
+      runDelta = delta;
+      runLength = 1;
+    }
+  }
+
+  last = sample;
+  samples++;
+  return true;
+}
+
+bool BERGCloudTimeSeriesEncoder::add(const int32_t *samples, uint16_t count)
+{
+  uint16_t i;
+
+  if ((samples == NULL) && (count > 0))
+  {
+    return false;
+  }
+
+  for (i=0; i<count; i++)
+  {
+    if (!add(samples[i]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+uint16_t BERGCloudTimeSeriesEncoder::end(void)
+{
+  flush();
+
+  if (message != NULL)
+  {
+    message->pack_raw_end(used);
+    message = NULL;
+  }
+
+  return used;
+}
+
+/*
+ * Decoder
+ */
+
+BERGCloudTimeSeriesDecoder::BERGCloudTimeSeriesDecoder(void)
+{
+  begin(NULL, 0);
+}
+
+void BERGCloudTimeSeriesDecoder::begin(const uint8_t *data, uint16_t size)
+{
+  in = data;
+  this->size = (data != NULL) ? size : 0;
+  used = 0;
+  started = false;
+  last = 0;
+  runDelta = 0;
+  runRemaining = 0;
+  invalid = false;
+}
+
+bool BERGCloudTimeSeriesDecoder::begin(BERGCloudMessageBase& message)
+{
+  const uint8_t *data;
+  uint16_t sizeInBytes;
+
+  begin(NULL, 0);
+
+  /* Decode in place; the data is skipped in the message */
+  if (!message.unpack_raw(data, sizeInBytes))
+  {
+    return false;
+  }
+
+  begin(data, sizeInBytes);
+  return true;
+}
+
+bool BERGCloudTimeSeriesDecoder::getVarint(uint32_t *value, bool *run)
+{
+  /* Returns FALSE at the end of the data; sets 'invalid' if the data */
+  /* ends part way through the value. If 'run' is not NULL the first */
+  /* byte has a run flag in place of the lowest bit. */
+  uint8_t data;
+  uint8_t shift;
+
+  if (used >= size)
+  {
+    return false;
+  }
+
+  data = in[used++];
+
+  if (run != NULL)
+  {
+    *run = (data & 0x01) != 0;
+    *value = (data & 0x7f) >> 1;
+    shift = 6;
+  }
+  else
+  {
+    *value = data & 0x7f;
+    shift = 7;
+  }
+
+  while (data & 0x80)
+  {
+    if ((used >= size) || (shift > 31))
+    {
+      invalid = true;
+      return false;
+    }
+
+    data = in[used++];
+    *value |= (uint32_t)(data & 0x7f) << shift;
+    shift += 7;
+  }
+
+  return true;
+}
+
+bool BERGCloudTimeSeriesDecoder::next(int32_t& sample)
+{
+  uint32_t value;
+  uint32_t count;
+  bool run;
+
+  if (invalid)
+  {
+    return false;
+  }
+
+  if (!started)
+  {
+    /* The first sample is written as it is */
+    if (!getVarint(&value, NULL))
+    {
+      return false;
+    }
+
+    started = true;
+    last = unzigzag(value);
+    sample = last;
+    return true;
+  }
+
+  if (runRemaining == 0)
+  {
+    if (!getVarint(&value, &run))
+    {
+      return false;
+    }
+
+    runDelta = (uint32_t)unzigzag(value);
+    runRemaining = 1;
+
+    if (run)
+    {
+      if (!getVarint(&count, NULL))
+      {
+        /* A run flag must be followed by its count */
+        invalid = true;
+        return false;
+      }
+
+      runRemaining += count + 1;
+    }
+  }
+
+  runRemaining--;
+  last = (int32_t)((uint32_t)last + runDelta);
+  sample = last;
+  return true;
+}
+
+uint16_t BERGCloudTimeSeriesDecoder::next(int32_t *samples, uint16_t maxCount)
+{
+  uint16_t count = 0;
+
+  if (samples == NULL)
+  {
+    return 0;
+  }
+
+  while ((count < maxCount) && next(samples[count]))
+  {
+    count++;
+  }
+
+  return count;
+}
+
+#endif // #ifdef BERGCLOUD_PACK_UNPACK
@@ -0,0 +1,106 @@
+/*
+
+BERGCloud time series encoding
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDTIMESERIES_H
+#define BERGCLOUDTIMESERIES_H
+
+#include "BERGCloudConfig.h"
+
+#ifdef BERGCLOUD_PACK_UNPACK
+
+#include "BERGCloudMessageBase.h"
+
+/*
+ * Encodes a series of samples compactly as raw data. The first sample
+ * is a zigzag varint; each following sample is coded as the change
+ * from the one before, and a change that repeats is coded once with a
+ * count. Each change is a zigzag varint with its lowest bit set if a
+ * varint count of further repeats, minus one, follows.
+ *
+ * A series whose samples change slowly or steadily (temperature,
+ * battery voltage, counters) takes one or two bytes for each change,
+ * and a run of identical changes takes two or three bytes in total.
+ */
+
+class BERGCloudTimeSeriesEncoder
+{
+public:
+  BERGCloudTimeSeriesEncoder(void);
+  /* Encode into 'buffer' */
+  void begin(uint8_t *buffer, uint16_t size);
+  /* Encode into the free space of 'message'; nothing else may be */
+  /* packed into the message until end() */
+  bool begin(BERGCloudMessageBase& message);
+  /* Add a sample; returns FALSE if there is not enough space */
+  bool add(int32_t sample);
+  bool add(const int32_t *samples, uint16_t count);
+  /* Finish the series, and pack it as raw data if encoding into a */
+  /* message; returns the size of the encoded series */
+  uint16_t end(void);
+  /* Samples added so far */
+  uint16_t samples;
+private:
+  uint8_t flushSize(void);
+  void flush(void);
+  BERGCloudMessageBase *message;
+  uint8_t *out;
+  uint16_t size;
+  uint16_t used;
+  int32_t last;
+  uint32_t runDelta;
+  uint16_t runLength;
+};
+
+class BERGCloudTimeSeriesDecoder
+{
+public:
+  BERGCloudTimeSeriesDecoder(void);
+  /* Decode from 'data' */
+  void begin(const uint8_t *data, uint16_t size);
+  /* Decode the raw data that is next in 'message' without copying */
+  /* it; the message must not change until the series is decoded */
+  bool begin(BERGCloudMessageBase& message);
+  /* Get the next sample; returns FALSE at the end of the series or */
+  /* if the data is not valid */
+  bool next(int32_t& sample);
+  /* Get up to 'maxCount' samples, returns the number decoded */
+  uint16_t next(int32_t *samples, uint16_t maxCount);
+  /* Set if the data ended part way through a value */
+  bool invalid;
+private:
+  bool getVarint(uint32_t *value, bool *run);
+  const uint8_t *in;
+  uint16_t size;
+  uint16_t used;
+  bool started;
+  int32_t last;
+  uint32_t runDelta;
+  uint32_t runRemaining;
+};
+
+#endif // #ifdef BERGCLOUD_PACK_UNPACK
+
+#endif // #ifndef BERGCLOUDTIMESERIES_H
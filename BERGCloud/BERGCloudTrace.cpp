@@ -0,0 +1,489 @@
+/*
+
+BERGCloud SPI trace recording and replay
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h> /* For memcpy() */
+
+#include "BERGCloudTrace.h"
+
+static const uint8_t traceMagic[4] = {'B', 'C', 'T', 'R'};
+
+/*
+ * Recorder
+ */
+
+BERGCloudTraceRecorder::BERGCloudTraceRecorder(void)
+{
+  target = NULL;
+  buffer = NULL;
+  bufferSize = 0;
+#ifdef LINUX
+  file = NULL;
+#endif
+  traceSize = 0;
+  overflow = false;
+  lastTime_uS = 0;
+  resetTime = 0;
+}
+
+bool BERGCloudTraceRecorder::begin(BERGCloudBase& backend, uint8_t *traceBuffer, uint32_t traceBufferSize)
+{
+  /* Call base class method */
+  BERGCloudBase::begin();
+
+  if (traceBuffer == NULL)
+  {
+    _LOG("Buffer is NULL (BERGCloudTraceRecorder::begin)\r\n");
+    return false;
+  }
+
+  target = &backend;
+  buffer = traceBuffer;
+  bufferSize = traceBufferSize;
+#ifdef LINUX
+  file = NULL;
+#endif
+
+  return writeHeader();
+}
+
+#ifdef LINUX
+bool BERGCloudTraceRecorder::begin(BERGCloudBase& backend, FILE *traceFile)
+{
+  /* Call base class method */
+  BERGCloudBase::begin();
+
+  if (traceFile == NULL)
+  {
+    _LOG("File is NULL (BERGCloudTraceRecorder::begin)\r\n");
+    return false;
+  }
+
+  target = &backend;
+  buffer = NULL;
+  bufferSize = 0;
+  file = traceFile;
+
+  return writeHeader();
+}
+#endif
+
+void BERGCloudTraceRecorder::end()
+{
+#ifdef LINUX
+  if (file != NULL)
+  {
+    fflush(file);
+  }
+#endif
+
+  /* Call base class method */
+  BERGCloudBase::end();
+}
+
+bool BERGCloudTraceRecorder::writeHeader(void)
+{
+  uint16_t hostType = target->getHostType();
+
+  traceSize = 0;
+  overflow = false;
+  lastTime_uS = target->timerNow_uS();
+
+  if (!reserve(BC_TRACE_HEADER_SIZE))
+  {
+    return false;
+  }
+
+  write(traceMagic, sizeof(traceMagic));
+  write(BC_TRACE_VERSION);
+  write(hostType & 0xff);
+  write(hostType >> 8);
+
+  return true;
+}
+
+uint16_t BERGCloudTraceRecorder::SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS)
+{
+  bool record;
+  uint16_t result;
+
+  if (target == NULL)
+  {
+    return 0;
+  }
+
+  /* Write the bytes sent first, as dataOut and dataIn may be the */
+  /* same buffer */
+  record = reserve(_BC_TRACE_RECORD_MAX_HEADER + (2 * (uint32_t)dataSize));
+
+  if (record)
+  {
+    write(_BC_TRACE_TRANSFER | (finalCS ? _BC_TRACE_FINAL_CS : 0));
+    writeVarint(delta_uS());
+    writeVarint(dataSize);
+    write(dataOut, dataSize);
+  }
+
+  result = target->SPITransaction(dataOut, dataIn, dataSize, finalCS);
+
+  if (record)
+  {
+    write(dataIn, dataSize);
+  }
+
+  return result;
+}
+
+void BERGCloudTraceRecorder::SPIDeselect(void)
+{
+  if (target == NULL)
+  {
+    return;
+  }
+
+  if (reserve(_BC_TRACE_RECORD_MAX_HEADER))
+  {
+    write(_BC_TRACE_DESELECT);
+    writeVarint(delta_uS());
+  }
+
+  target->SPIDeselect();
+}
+
+void BERGCloudTraceRecorder::timerReset(void)
+{
+  /* Called by begin() before there is a backend */
+  resetTime = (target != NULL) ? target->timerNow_mS() : 0;
+}
+
+uint32_t BERGCloudTraceRecorder::timerRead_mS(void)
+{
+  return timerNow_mS() - resetTime;
+}
+
+uint32_t BERGCloudTraceRecorder::timerNow_mS(void)
+{
+  return target->timerNow_mS();
+}
+
+uint32_t BERGCloudTraceRecorder::timerNow_uS(void)
+{
+  return target->timerNow_uS();
+}
+
+void BERGCloudTraceRecorder::timerWait_uS(uint32_t time_uS)
+{
+  target->timerWait_uS(time_uS);
+}
+
+uint16_t BERGCloudTraceRecorder::getHostType(void)
+{
+  return target->getHostType();
+}
+
+bool BERGCloudTraceRecorder::reserve(uint32_t size)
+{
+  /* Returns TRUE if a record of up to 'size' bytes can be written */
+
+  if (overflow)
+  {
+    return false;
+  }
+
+#ifdef LINUX
+  if (file != NULL)
+  {
+    return true;
+  }
+#endif
+
+  if ((buffer == NULL) || ((bufferSize - traceSize) < size))
+  {
+    /* Stop here so the trace ends with a whole record */
+    overflow = true;
+    return false;
+  }
+
+  return true;
+}
+
+void BERGCloudTraceRecorder::write(uint8_t data)
+{
+  write(&data, 1);
+}
+
+void BERGCloudTraceRecorder::write(const uint8_t *data, uint16_t size)
+{
+#ifdef LINUX
+  if (file != NULL)
+  {
+    if (fwrite(data, 1, size, file) != size)
+    {
+      _LOG("Write failed (BERGCloudTraceRecorder::write)\r\n");
+      overflow = true;
+    }
+
+    traceSize += size;
+    return;
+  }
+#endif
+
+  memcpy(&buffer[traceSize], data, size);
+  traceSize += size;
+}
+
+void BERGCloudTraceRecorder::writeVarint(uint32_t value)
+{
+  while (value >= 0x80)
+  {
+    write((value & 0x7f) | 0x80);
+    value >>= 7;
+  }
+
+  write(value);
+}
+
+uint32_t BERGCloudTraceRecorder::delta_uS(void)
+{
+  uint32_t now = target->timerNow_uS();
+  uint32_t delta = now - lastTime_uS;
+
+  lastTime_uS = now;
+  return delta;
+}
+
+/*
+ * Replay
+ */
+
+BERGCloudTraceReplay::BERGCloudTraceReplay(void)
+{
+  trace = NULL;
+  traceSize = 0;
+  hostType = BC_HOST_UNKNOWN;
+  resetTime = 0;
+  rewind();
+}
+
+bool BERGCloudTraceReplay::begin(const uint8_t *data, uint32_t size)
+{
+  /* Call base class method */
+  BERGCloudBase::begin();
+
+  if ((data == NULL) || (size < BC_TRACE_HEADER_SIZE) ||
+      (memcmp(data, traceMagic, sizeof(traceMagic)) != 0) ||
+      (data[4] != BC_TRACE_VERSION))
+  {
+    _LOG("Invalid trace (BERGCloudTraceReplay::begin)\r\n");
+    trace = NULL;
+    traceSize = 0;
+    return false;
+  }
+
+  trace = data;
+  traceSize = size;
+  hostType = data[5] | (data[6] << 8);
+  rewind();
+
+  return true;
+}
+
+void BERGCloudTraceReplay::end()
+{
+  /* Call base class method */
+  BERGCloudBase::end();
+}
+
+void BERGCloudTraceReplay::rewind(void)
+{
+  offset = BC_TRACE_HEADER_SIZE;
+  transferOut = NULL;
+  transferIn = NULL;
+  transferSize = 0;
+  transferIndex = 0;
+  now_uS = 0;
+  traceTime_uS = 0;
+  mismatches = 0;
+  bytesReplayed = 0;
+}
+
+bool BERGCloudTraceReplay::finished(void)
+{
+  return (offset >= traceSize) && (transferIndex >= transferSize);
+}
+
+uint16_t BERGCloudTraceReplay::SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS)
+{
+  uint16_t i;
+
+  /* nCS isn't modelled; the trace is compared byte by byte */
+  (void)finalCS;
+
+  if ( (dataOut == NULL) || (dataIn == NULL) )
+  {
+    _LOG("Invalid parameter (BERGCloudTraceReplay::SPITransaction)\r\n");
+    return 0;
+  }
+
+  /* The trace is played back as a byte stream, so it doesn't matter */
+  /* if the bytes were recorded in different sized transfers */
+  for (i = 0; i < dataSize; i++)
+  {
+    if ((transferIndex >= transferSize) && !nextTransfer())
+    {
+      /* End of the trace; a reset ends any transaction in progress */
+      dataIn[i] = SPI_PROTOCOL_RESET;
+      now_uS += _BC_TRACE_END_STEP_US;
+      continue;
+    }
+
+    if (dataOut[i] != transferOut[transferIndex])
+    {
+      mismatches++;
+    }
+
+    dataIn[i] = transferIn[transferIndex++];
+    bytesReplayed++;
+  }
+
+  return dataSize;
+}
+
+void BERGCloudTraceReplay::SPIDeselect(void)
+{
+}
+
+void BERGCloudTraceReplay::timerReset(void)
+{
+  resetTime = timerNow_mS();
+}
+
+uint32_t BERGCloudTraceReplay::timerRead_mS(void)
+{
+  return timerNow_mS() - resetTime;
+}
+
+uint32_t BERGCloudTraceReplay::timerNow_mS(void)
+{
+  return now_uS / 1000;
+}
+
+uint32_t BERGCloudTraceReplay::timerNow_uS(void)
+{
+  return now_uS;
+}
+
+void BERGCloudTraceReplay::timerWait_uS(uint32_t time_uS)
+{
+  /* No need to actually wait */
+  now_uS += time_uS;
+}
+
+uint16_t BERGCloudTraceReplay::getHostType(void)
+{
+  return hostType;
+}
+
+bool BERGCloudTraceReplay::nextTransfer(void)
+{
+  /* Move to the next transfer record, skipping deselects */
+
+  uint8_t tag;
+  uint32_t delta;
+  uint32_t size;
+
+  while (offset < traceSize)
+  {
+    tag = trace[offset++];
+
+    if (!readVarint(&delta))
+    {
+      break;
+    }
+
+    /* Time moves on to the recorded time unless the host has */
+    /* already waited longer */
+    traceTime_uS += delta;
+
+    if ((int32_t)(traceTime_uS - now_uS) > 0)
+    {
+      now_uS = traceTime_uS;
+    }
+
+    if ((tag & 0xf0) == _BC_TRACE_DESELECT)
+    {
+      continue;
+    }
+
+    if (((tag & 0xf0) != _BC_TRACE_TRANSFER) || !readVarint(&size) ||
+        ((traceSize - offset) < (2 * size)))
+    {
+      break;
+    }
+
+    transferOut = &trace[offset];
+    transferIn = &trace[offset + size];
+    transferSize = size;
+    transferIndex = 0;
+    offset += 2 * size;
+
+    if (size > 0)
+    {
+      return true;
+    }
+  }
+
+  /* End of the trace, or a bad record */
+  offset = traceSize;
+  transferSize = 0;
+  transferIndex = 0;
+  return false;
+}
+
+bool BERGCloudTraceReplay::readVarint(uint32_t *value)
+{
+  uint8_t shift = 0;
+  uint8_t data;
+
+  *value = 0;
+
+  do {
+    if ((offset >= traceSize) || (shift > 28))
+    {
+      return false;
+    }
+
+    data = trace[offset++];
+    *value |= (uint32_t)(data & 0x7f) << shift;
+    shift += 7;
+
+  } while (data & 0x80);
+
+  return true;
+}
@@ -0,0 +1,147 @@
+/*
+
+BERGCloud SPI trace recording and replay
+
+Copyright (c) 2013 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDTRACE_H
+#define BERGCLOUDTRACE_H
+
+#include "BERGCloudBase.h"
+
+#ifdef LINUX
+#include <stdio.h>
+#endif
+
+/* A trace is a header followed by one record per SPITransaction() or */
+/* SPIDeselect() call:                                                */
+/*                                                                    */
+/*   header:   'B' 'C' 'T' 'R', version, host type (2 bytes, LSB first) */
+/*   transfer: _BC_TRACE_TRANSFER | finalCS, time, size,              */
+/*             bytes sent, bytes received                             */
+/*   deselect: _BC_TRACE_DESELECT, time                               */
+/*                                                                    */
+/* Time is microseconds since the previous record and size is a byte  */
+/* count, both as base-128 varints.                                   */
+
+#define BC_TRACE_VERSION           1
+#define BC_TRACE_HEADER_SIZE       7
+
+#define _BC_TRACE_TRANSFER         0x10
+#define _BC_TRACE_FINAL_CS         0x01
+#define _BC_TRACE_DESELECT         0x20
+
+/* Largest record header: tag plus two 32-bit varints */
+#define _BC_TRACE_RECORD_MAX_HEADER (1 + 5 + 5)
+
+/* Time that passes for each byte read after the end of a trace, so */
+/* that timeouts still expire */
+#define _BC_TRACE_END_STEP_US      100
+
+/* Records the SPI traffic of another backend. Use the recorder in */
+/* place of the backend, after calling the backend's own begin(). */
+class BERGCloudTraceRecorder : public BERGCloudBase
+{
+public:
+  BERGCloudTraceRecorder(void);
+  /* Record into a buffer; recording stops when it is full */
+  bool begin(BERGCloudBase& backend, uint8_t *traceBuffer, uint32_t traceBufferSize);
+#ifdef LINUX
+  /* Record into an open file */
+  bool begin(BERGCloudBase& backend, FILE *traceFile);
+#endif
+  void end();
+  /* Size of the trace so far */
+  uint32_t traceSize;
+  /* TRUE if records were lost because the buffer was full */
+  bool overflow;
+private:
+  uint16_t SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS);
+  void SPIDeselect(void);
+  void timerReset(void);
+  uint32_t timerRead_mS(void);
+  uint32_t timerNow_mS(void);
+  uint32_t timerNow_uS(void);
+  void timerWait_uS(uint32_t time_uS);
+  uint16_t getHostType(void);
+  bool writeHeader(void);
+  bool reserve(uint32_t size);
+  void write(uint8_t data);
+  void write(const uint8_t *data, uint16_t size);
+  void writeVarint(uint32_t value);
+  uint32_t delta_uS(void);
+  BERGCloudBase *target;
+  uint8_t *buffer;
+  uint32_t bufferSize;
+#ifdef LINUX
+  FILE *file;
+#endif
+  uint32_t lastTime_uS;
+  uint32_t resetTime;
+};
+
+/* Plays a trace back as fast as possible. The shield's side of each */
+/* transfer is returned, the timer follows the recorded times and */
+/* waits return immediately. */
+class BERGCloudTraceReplay : public BERGCloudBase
+{
+public:
+  BERGCloudTraceReplay(void);
+  /* The trace must remain valid until end() */
+  bool begin(const uint8_t *data, uint32_t size);
+  void end();
+  /* Start again from the first record */
+  void rewind(void);
+  /* TRUE once every record has been used; after this the shield */
+  /* appears to have reset */
+  bool finished(void);
+  /* Bytes sent by the host that differ from the trace */
+  uint32_t mismatches;
+  /* Bytes played back */
+  uint32_t bytesReplayed;
+private:
+  uint16_t SPITransaction(uint8_t *dataOut, uint8_t *dataIn, uint16_t dataSize, bool finalCS);
+  void SPIDeselect(void);
+  void timerReset(void);
+  uint32_t timerRead_mS(void);
+  uint32_t timerNow_mS(void);
+  uint32_t timerNow_uS(void);
+  void timerWait_uS(uint32_t time_uS);
+  uint16_t getHostType(void);
+  bool nextTransfer(void);
+  bool readVarint(uint32_t *value);
+  const uint8_t *trace;
+  uint32_t traceSize;
+  uint32_t offset;
+  /* The transfer being played back */
+  const uint8_t *transferOut;
+  const uint8_t *transferIn;
+  uint32_t transferSize;
+  uint32_t transferIndex;
+  uint32_t traceTime_uS;
+  uint32_t now_uS;
+  uint32_t resetTime;
+  uint16_t hostType;
+};
+
+#endif // #ifndef BERGCLOUDTRACE_H
@@ -0,0 +1,159 @@
+/*
+    CommandRouter - Calls a function for each command by name, rather than
+                    with a switch statement. Names can be in RAM or, with
+                    F(), in flash. For more info see http://bergcloud.com/
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <BERGCloud.h>
+#include <BERGCloudCommandRouter.h>
+#include <SPI.h>
+
+#define nSSEL_PIN 10 // SPI Slave select definition -
+//You should not need to change nSSEL_PIN unless you are using a Mega or Leonardo
+
+// The Project Key ties this code into a Project on developer.bergcloud.com
+const byte PROJECT_KEY[BC_KEY_SIZE_BYTES] = \
+    {0x8B,0x05,0xF7,0x25,0x10,0x54,0x0A,0xE4,0x7C,0x35,0xEE,0xE7,0x26,0xDC,0xD5,0xA8};
+
+// The version of your code
+#define VERSION 1
+
+// Calls a handler for each command received
+BERGCloudCommandRouter router(BERGCloud);
+
+unsigned int counter;
+unsigned int calls;
+
+// Each handler is given the command's data ready to unpack. The router
+// passes on the message given to poll() or dispatch(), which here is
+// always a BERGCloudMessage.
+
+void handleSetCounter(BERGCloudMessageBuffer &buffer) {
+  BERGCloudMessage &command = static_cast<BERGCloudMessage &>(buffer);
+  unsigned int value;
+
+  calls++;
+  if (command.unpack(value)) {
+    counter = value;
+    Serial.print("Counter set to ");
+    Serial.println(counter, DEC);
+  }
+}
+
+void handleResetCounter(BERGCloudMessageBuffer &buffer) {
+  calls++;
+  counter = 0;
+  Serial.println("Counter reset");
+}
+
+void handleDisplayText(BERGCloudMessageBuffer &buffer) {
+  BERGCloudMessage &command = static_cast<BERGCloudMessage &>(buffer);
+  String text;
+
+  calls++;
+  if (command.unpack(text)) {
+    BERGCloud.clearDisplay();
+    BERGCloud.display(text);
+  }
+}
+
+void handleClearDisplay(BERGCloudMessageBuffer &buffer) {
+  calls++;
+  BERGCloud.clearDisplay();
+}
+
+void handleUnknown(const char *commandName, uint8_t commandNameSize, BERGCloudMessageBuffer &buffer) {
+  Serial.println("WARNING: Unknown command");
+}
+
+// Dispatch each command once without the shield, to check that every
+// name finds its handler whether it is in RAM or in flash
+bool selfTest() {
+  const char *names[] = {"reset-counter", "set-counter", "display-text", "clear-display"};
+  BERGCloudMessage command;
+  uint8_t i;
+
+  calls = 0;
+
+  for (i = 0; i < 4; i++) {
+    command.clear();
+    if (strcmp(names[i], "display-text") == 0) {
+      command.pack("Self test");
+    } else {
+      command.pack(42U);
+    }
+    command.restart();
+
+    if (!router.dispatch(names[i], strlen(names[i]), command)) {
+      Serial.print("Self test: no handler for ");
+      Serial.println(names[i]);
+      return false;
+    }
+  }
+
+  if ((calls != 4) || (counter != 42) || router.dispatch("set-count", 9, command)) {
+    Serial.println("Self test: wrong handler called");
+    return false;
+  }
+
+  router.clearStats();
+  return true;
+}
+
+void setup()
+{
+  Serial.begin(115200);
+  BERGCloud.begin(&SPI, nSSEL_PIN);
+  Serial.println("--- Arduino reset ---");
+
+  counter = 0;
+
+  // Names in RAM must stay valid, so use string literals or globals
+  router.add("set-counter", handleSetCounter);
+  router.add("display-text", handleDisplayText);
+
+  // Names in flash take no RAM on AVR
+  router.add(F("reset-counter"), handleResetCounter);
+  router.add(F("clear-display"), handleClearDisplay);
+
+  router.setUnknownHandler(handleUnknown);
+
+  // Measure how long set-counter takes, see router.getStats()
+  router.setTiming("set-counter");
+
+  if (selfTest()) {
+    Serial.println("Self test passed");
+  }
+
+  // Attempt to connect with our project key and build version
+  if (BERGCloud.connect(PROJECT_KEY, VERSION)) {
+    Serial.println("Connected to network");
+  } else {
+    Serial.println("BERGCloud.connect() returned false.");
+  }
+}
+
+void loop()
+{
+  BERGCloudMessage command;
+  const BERGCloudCommandRouteStats *stats;
+
+  // Calls the handler for the command, if there is one
+  if (router.poll(command)) {
+    stats = router.getStats("set-counter");
+
+    if (stats->calls > 0) {
+      Serial.print("set-counter: ");
+      Serial.print(stats->calls);
+      Serial.print(" calls, longest ");
+      Serial.print(stats->maxTime_uS);
+      Serial.println(" uS");
+    }
+  }
+
+  delay(1000);
+}
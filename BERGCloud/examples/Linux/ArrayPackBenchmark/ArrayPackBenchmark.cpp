@@ -0,0 +1,149 @@
+/*
+    ArrayPackBenchmark - Compares packing and unpacking an array of
+                         samples one value at a time with the bulk
+                         pack_array() and unpack_array() methods.
+
+    Build from this directory with:
+
+      g++ -O2 -DLINUX -DBERGCLOUD_PACK_UNPACK -DBUFFER_SIZE_BYTES=2048 \
+          -I../../.. ArrayPackBenchmark.cpp ../../../BERGCloudMessageBase.cpp \
+          ../../../BERGCloudMessageBuffer.cpp ../../../BERGCloudByteSwap.cpp \
+          -o ArrayPackBenchmark
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "BERGCloudLinux.h"
+
+/* Samples per array; 200 64-bit values fill most of the buffer */
+#define SAMPLES 200
+
+/* Arrays packed and unpacked per measurement */
+#define ITERATIONS 100000
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+template <typename T> static bool packEach(BERGCloudMessage& message, const T *values, uint16_t count)
+{
+  uint16_t i;
+
+  if (!message.pack_array(count))
+  {
+    return false;
+  }
+
+  for (i=0; i<count; i++)
+  {
+    if (!message.pack(values[i]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename T> static bool unpackEach(BERGCloudMessage& message, T *values, uint16_t maxCount, uint16_t& count)
+{
+  uint16_t i;
+
+  if (!message.unpack_array(count) || (count > maxCount))
+  {
+    return false;
+  }
+
+  for (i=0; i<count; i++)
+  {
+    if (!message.unpack(values[i]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <typename T> static void benchmark(const char *name)
+{
+  static T values[SAMPLES];
+  static T unpacked[SAMPLES];
+  BERGCloudMessage message;
+  uint16_t count;
+  uint32_t i;
+  double start, packEachTime, packBulkTime, unpackEachTime, unpackBulkTime;
+
+  for (i=0; i<SAMPLES; i++)
+  {
+    values[i] = (T)(rand() % 1000);
+  }
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    message.clear();
+    packEach(message, values, SAMPLES);
+  }
+  packEachTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    message.clear();
+    message.pack_array(values, SAMPLES);
+  }
+  packBulkTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    message.restart();
+    unpackEach(message, unpacked, SAMPLES, count);
+  }
+  unpackEachTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    message.restart();
+    message.unpack_array(unpacked, SAMPLES, count);
+  }
+  unpackBulkTime = now() - start;
+
+  if ((count != SAMPLES) || (memcmp(values, unpacked, sizeof(values)) != 0))
+  {
+    printf("  %-8s MISMATCH\n", name);
+    return;
+  }
+
+  printf("  %-8s pack %6.1f -> %5.1f ns, unpack %6.1f -> %5.1f ns (%4.1fx, %4.1fx)\n", name,
+    (packEachTime * 1e9) / ((double)ITERATIONS * SAMPLES),
+    (packBulkTime * 1e9) / ((double)ITERATIONS * SAMPLES),
+    (unpackEachTime * 1e9) / ((double)ITERATIONS * SAMPLES),
+    (unpackBulkTime * 1e9) / ((double)ITERATIONS * SAMPLES),
+    packEachTime / packBulkTime, unpackEachTime / unpackBulkTime);
+}
+
+int main(void)
+{
+  printf("Time per value for %u-value arrays, one at a time -> bulk:\n", SAMPLES);
+
+  benchmark<uint8_t>("uint8_t");
+  benchmark<int16_t>("int16_t");
+  benchmark<int32_t>("int32_t");
+  benchmark<int64_t>("int64_t");
+  benchmark<float>("float");
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+/*
+    CRC16Benchmark - Checks that every CRC16 implementation available on
+                     this host gives the same result as the bitwise
+                     reference, then measures the throughput of each.
+
+    Build from this directory with:
+
+      g++ -O2 -DLINUX -I../../.. CRC16Benchmark.cpp \
+          ../../../BERGCloudCRC16.cpp -o CRC16Benchmark
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "BERGCloudCRC16.h"
+
+typedef uint16_t (*crc16_fn)(const uint8_t *data, size_t size, uint16_t seed);
+
+struct Variant {
+  const char *name;
+  crc16_fn fn;
+};
+
+static const Variant variants[] = {
+  { "bitwise", crc16_bitwise },
+  { "table",   crc16_table },
+  { "slice4",  crc16_slice4 },
+  { "slice8",  crc16_slice8 },
+#ifdef BERGCLOUD_CRC16_HAVE_PCLMUL
+  { "pclmul",  crc16_pclmul },
+#endif
+  { "crc16()", crc16 },
+};
+
+#define VARIANTS (sizeof(variants) / sizeof(variants[0]))
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static bool check(void)
+{
+  static uint8_t data[1024];
+  size_t size, i, v;
+  uint16_t seed, expected, actual;
+
+  for (i=0; i<sizeof(data); i++)
+  {
+    data[i] = rand();
+  }
+
+  for (size=0; size<=sizeof(data); size++)
+  {
+    seed = (size & 1) ? 0xffff : rand();
+    expected = crc16_bitwise(data, size, seed);
+
+    for (v=0; v<VARIANTS; v++)
+    {
+      actual = variants[v].fn(data, size, seed);
+
+      if (actual != expected)
+      {
+        printf("MISMATCH: %s, size %u, seed 0x%04x: 0x%04x != 0x%04x\n",
+          variants[v].name, (unsigned)size, seed, actual, expected);
+        return false;
+      }
+    }
+  }
+
+  /* Check value for "123456789" */
+  printf("crc16(\"123456789\", 0xffff) = 0x%04x (expect 0x29b1)\n",
+    crc16((const uint8_t *)"123456789", 9, 0xffff));
+  return true;
+}
+
+static void benchmark(size_t size)
+{
+  static uint8_t data[4096];
+  volatile uint16_t sink = 0;
+  size_t v, i, iterations;
+  double start, elapsed;
+
+  for (i=0; i<size; i++)
+  {
+    data[i] = rand();
+  }
+
+  /* Process roughly 64MB per variant */
+  iterations = (64 * 1024 * 1024) / size;
+
+  printf("\n%u-byte buffers:\n", (unsigned)size);
+
+  for (v=0; v<VARIANTS; v++)
+  {
+    start = now();
+
+    for (i=0; i<iterations; i++)
+    {
+      sink = variants[v].fn(data, size, sink);
+    }
+
+    elapsed = now() - start;
+    printf("  %-8s %8.1f MB/s\n", variants[v].name,
+      (iterations * size) / (elapsed * 1024 * 1024));
+  }
+}
+
+int main(void)
+{
+  if (!check())
+  {
+    return 1;
+  }
+
+  printf("All implementations match.\n");
+
+  benchmark(6);     /* Empty request frame */
+  benchmark(128);   /* Largest SPI frame */
+  benchmark(4096);  /* Trace replay, large buffers */
+
+  return 0;
+}
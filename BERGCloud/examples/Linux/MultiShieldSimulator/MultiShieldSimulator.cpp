@@ -0,0 +1,254 @@
+/*
+    MultiShieldSimulator - Shares events between two simulated shields
+                  with BERGCloudRoundRobin, as the MultiShield example
+                  does with two Devshields on one SPI bus. Shield B is
+                  disconnected for a while so that its events are
+                  retried. Checks that every event arrives exactly once
+                  and that only one shield at a time is part way through
+                  a transaction, as nCS stays low on that shield until
+                  the transaction ends. Then compares the throughput
+                  of one, two and four shields whose radios each take
+                  8 ms to send an event.
+
+    Build from this directory with:
+
+      g++ -O2 -DLINUX -DBERGCLOUD_PACK_UNPACK -I../../.. MultiShieldSimulator.cpp \
+          ../../../BERGCloud[A-Z]*.cpp -o MultiShieldSimulator -lpthread
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "BERGCloudSimulator.h"
+#include "BERGCloudRoundRobin.h"
+
+#define MAX_SHIELDS   BC_ROUND_ROBIN_MAX_SHIELDS
+#define EVENTS        200
+/* Virtual time between calls to service() */
+#define TICK_US       1000
+/* Ticks between events; zero queues them as fast as the outboxes allow */
+#define EVENT_TICKS   5
+/* Ticks for a shield's radio to send one event */
+#define RADIO_TICKS   8
+/* Shield B is disconnected between these ticks */
+#define OUTAGE_START  100
+#define OUTAGE_END    400
+#define MAX_TICKS     20000
+
+static uint8_t received[EVENTS];
+static uint32_t receivedBy[MAX_SHIELDS];
+
+static bool takeEvent(BERGCloudSimulator& shield, uint8_t s)
+{
+  /* Take the next event queued by a shield, as its radio would send */
+  /* it; returns FALSE if it is invalid */
+
+  uint8_t event[SPI_MAX_PAYLOAD_SIZE_BYTES];
+  uint16_t eventSize;
+  uint16_t offset;
+  uint16_t number;
+
+  if (shield.takeEvent(event, sizeof(event), eventSize))
+  {
+    /* Skip the event header and name */
+    offset = SPI_EVENT_HEADER_SIZE_BYTES + 1 + (event[SPI_EVENT_HEADER_SIZE_BYTES] & 0x1f);
+
+    if (eventSize != (offset + 2))
+    {
+      return false;
+    }
+
+    number = (event[offset] << 8) | event[offset + 1];
+
+    if (number >= EVENTS)
+    {
+      return false;
+    }
+
+    received[number]++;
+    receivedBy[s]++;
+  }
+
+  return true;
+}
+
+static bool run(uint8_t shields, uint32_t eventTicks, bool outage, uint32_t& ticks)
+{
+  /* Send EVENTS events through 'shields' simulated shields; returns */
+  /* FALSE if any event is lost, duplicated or sent while another */
+  /* shield holds nCS low */
+
+  /* Events stay queued until takeEvent(), which models a radio */
+  /* slower than the host, so the shields' queues fill up */
+  BERGCloudSimulatorConfig config = {2, 1, 1000, 0, 500, 4, 2};
+  BERGCloudSimulator shield[MAX_SHIELDS];
+  BERGCloudEventOutbox *outbox[MAX_SHIELDS];
+  BERGCloudRoundRobin roundRobin;
+  uint32_t tick;
+  uint16_t queued = 0;
+  uint32_t maxSending = 0;
+  uint32_t sending;
+  uint16_t waiting;
+  uint8_t data[2];
+  uint8_t s;
+  uint16_t i;
+  bool ok = true;
+
+  memset(received, 0x00, sizeof(received));
+  memset(receivedBy, 0x00, sizeof(receivedBy));
+
+  for (s=0; s<shields; s++)
+  {
+    if (!shield[s].begin(&config) || !shield[s].connect(BERGCloudBase::nullKey, 1, true))
+    {
+      printf("Shield %c: connect failed\n", 'A' + s);
+      return false;
+    }
+
+    /* Retry a full shield after about the time its radio takes to */
+    /* send an event */
+    outbox[s] = new BERGCloudEventOutbox(shield[s], RADIO_TICKS * (TICK_US / 1000), 1000);
+    roundRobin.add(*outbox[s]);
+  }
+
+  for (tick=0; tick<MAX_TICKS; tick++)
+  {
+    if (outage && (tick == OUTAGE_START))
+    {
+      shield[1].setConnectionState(BC_CONNECT_STATE_DISCONNECTED);
+    }
+
+    if (outage && (tick == OUTAGE_END))
+    {
+      shield[1].setConnectionState(BC_CONNECT_STATE_CONNECTED);
+    }
+
+    if (((eventTicks == 0) || ((tick % eventTicks) == 0)) && (queued < EVENTS))
+    {
+      data[0] = queued >> 8;
+      data[1] = queued & 0xff;
+
+      if (roundRobin.queue("reading", data, sizeof(data), 20))
+      {
+        queued++;
+      }
+    }
+
+    if (!roundRobin.service())
+    {
+      printf("An event was dropped\n");
+      ok = false;
+    }
+
+    /* Only one shield may hold nCS low at a time */
+    sending = 0;
+
+    for (s=0; s<shields; s++)
+    {
+      if (outbox[s]->sending())
+      {
+        sending++;
+      }
+    }
+
+    if (sending > maxSending)
+    {
+      maxSending = sending;
+    }
+
+    waiting = roundRobin.eventsQueued();
+
+    for (s=0; s<shields; s++)
+    {
+      shield[s].advanceTime_uS(TICK_US);
+
+      if (((tick % RADIO_TICKS) == 0) && !takeEvent(shield[s], s))
+      {
+        printf("Shield %c: invalid event\n", 'A' + s);
+        ok = false;
+      }
+
+      waiting += shield[s].eventsQueued();
+    }
+
+    if ((queued == EVENTS) && (waiting == 0))
+    {
+      break;
+    }
+  }
+
+  ticks = tick;
+
+  for (i=0; i<EVENTS; i++)
+  {
+    if (received[i] != 1)
+    {
+      printf("Event %u received %u times\n", i, received[i]);
+      ok = false;
+    }
+  }
+
+  for (s=0; s<shields; s++)
+  {
+    printf("  Shield %c: %lu events, %lu sent by the outbox, %lu transient failures\n", 'A' + s,
+      (unsigned long)receivedBy[s], (unsigned long)outbox[s]->eventsSent, (unsigned long)outbox[s]->transientFailures);
+
+    if (receivedBy[s] == 0)
+    {
+      ok = false;
+    }
+
+    delete outbox[s];
+  }
+
+  if (maxSending > 1)
+  {
+    printf("  %lu shields sending at once\n", (unsigned long)maxSending);
+    ok = false;
+  }
+
+  return ok;
+}
+
+int main(void)
+{
+  const uint8_t shields[] = {1, 2, 4};
+  uint32_t ticks, oneShieldTicks = 0;
+  uint8_t i;
+  bool ok = true;
+
+  /* Shield B's events are retried, and the other shield takes more */
+  /* of the load, while it is disconnected */
+  printf("Two shields, shield B disconnected from %u to %u ms:\n", OUTAGE_START, OUTAGE_END);
+  if (!run(2, EVENT_TICKS, true, ticks))
+  {
+    ok = false;
+  }
+  printf("  Finished after %lu ms\n", (unsigned long)ticks);
+
+  /* Only one SPI transaction is in progress at a time, so any gain */
+  /* comes from the shields' radios sending their queues in parallel */
+  printf("Throughput with events queued as fast as they are accepted:\n");
+  for (i=0; i<sizeof(shields); i++)
+  {
+    if (!run(shields[i], 0, false, ticks))
+    {
+      ok = false;
+    }
+
+    if (i == 0)
+    {
+      oneShieldTicks = ticks;
+    }
+
+    printf("  %u shield%s: %u events in %lu ms, %.0f events/s (%.2fx)\n", shields[i], (shields[i] == 1) ? "" : "s",
+      EVENTS, (unsigned long)ticks, (EVENTS * 1000.0) / ticks, (double)oneShieldTicks / ticks);
+  }
+
+  printf("%s\n", ok ? "PASS" : "FAIL");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+/*
+    PackSizeBenchmark - Packs typical sensor readings with and without
+                        pack_compact() and reports how many readings fit
+                        in one named event.
+
+    Build from this directory with:
+
+      g++ -O2 -DLINUX -DBERGCLOUD_PACK_UNPACK -DBUFFER_SIZE_BYTES=256 \
+          -I../../.. PackSizeBenchmark.cpp ../../../BERGCloudMessageBase.cpp \
+          ../../../BERGCloudMessageBuffer.cpp ../../../BERGCloudByteSwap.cpp \
+          -o PackSizeBenchmark
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BERGCloudLinux.h"
+
+/* Space for data in an event named "readings" */
+#define EVENT_DATA_SIZE (SPI_MAX_PAYLOAD_SIZE_BYTES - (SPI_EVENT_HEADER_SIZE_BYTES + 1 + 8))
+
+struct Reading {
+  int16_t temperature;  /* Hundredths of a degree C */
+  uint8_t humidity;     /* Percent */
+  uint16_t light;       /* Lux */
+  uint16_t battery;     /* Millivolts */
+  int8_t rssi;          /* dBm */
+  uint32_t sequence;
+};
+
+static void makeReading(Reading *r, uint32_t i)
+{
+  r->temperature = 1800 + (rand() % 900) - ((i % 50) == 0 ? 2500 : 0);
+  r->humidity = 30 + (rand() % 50);
+  r->light = ((i % 24) < 8) ? (rand() % 20) : (200 + (rand() % 800));
+  r->battery = 3000 + (rand() % 1200);
+  r->rssi = -40 - (rand() % 60);
+  r->sequence = i;
+}
+
+static bool packReading(BERGCloudMessage& message, const Reading *r)
+{
+  return message.pack_array(6) &&
+    message.pack(r->temperature) &&
+    message.pack(r->humidity) &&
+    message.pack(r->light) &&
+    message.pack(r->battery) &&
+    message.pack(r->rssi) &&
+    message.pack(r->sequence);
+}
+
+static void measure(const char *name, bool compact, uint32_t count)
+{
+  BERGCloudMessage message;
+  Reading r;
+  uint32_t i, total, perEvent, events;
+  uint16_t before;
+
+  srand(1);
+  total = 0;
+  perEvent = 0;
+  events = 0;
+
+  message.pack_compact(compact);
+
+  for (i=0; i<count; i++)
+  {
+    makeReading(&r, i);
+
+    before = message.used();
+
+    if (!packReading(message, &r) || (message.used() > EVENT_DATA_SIZE))
+    {
+      /* Start a new event with this reading */
+      events++;
+      message.clear();
+      packReading(message, &r);
+      before = 0;
+    }
+
+    total += message.used() - before;
+  }
+
+  events++;
+  perEvent = count / events;
+
+  printf("  %-8s %5.2f bytes per reading, %3u readings per event, %u events\n",
+    name, (double)total / count, perEvent, events);
+}
+
+int main(void)
+{
+  printf("%u readings, %u bytes of data per event:\n", 10000, EVENT_DATA_SIZE);
+  measure("fixed", false, 10000);
+  measure("compact", true, 10000);
+
+  return 0;
+}
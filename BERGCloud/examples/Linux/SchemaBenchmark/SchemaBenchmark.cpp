@@ -0,0 +1,188 @@
+/*
+    SchemaBenchmark - Packs and unpacks a structure with BERGCloudSchema
+                      and compares the result with the same fields
+                      packed by hand with individual pack() calls.
+
+    Build from this directory with:
+
+      g++ -std=gnu++11 -O2 -DLINUX -DBERGCLOUD_PACK_UNPACK \
+          -I../../.. SchemaBenchmark.cpp ../../../BERGCloudMessageBase.cpp \
+          ../../../BERGCloudMessageBuffer.cpp ../../../BERGCloudByteSwap.cpp \
+          -o SchemaBenchmark
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "BERGCloudLinux.h"
+#include "BERGCloudSchema.h"
+
+/* Structures packed and unpacked per measurement */
+#define ITERATIONS 1000000
+
+struct Reading
+{
+  int16_t temperature;
+  uint8_t humidity;
+  char location[12];
+  float volts;
+  bool charging;
+  int8_t samples[4];
+  uint32_t sequence;
+};
+
+typedef BERGCloudSchema<Reading,
+  BERGCLOUD_SCHEMA_FIELD(Reading, temperature),
+  BERGCLOUD_SCHEMA_FIELD(Reading, humidity),
+  BERGCLOUD_SCHEMA_FIELD(Reading, location),
+  BERGCLOUD_SCHEMA_FIELD(Reading, volts),
+  BERGCLOUD_SCHEMA_FIELD(Reading, charging),
+  BERGCLOUD_SCHEMA_FIELD(Reading, samples),
+  BERGCLOUD_SCHEMA_FIELD(Reading, sequence)> ReadingSchema;
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static bool packByHand(BERGCloudMessage& message, const Reading& r)
+{
+  uint16_t i;
+
+  if (!message.pack(r.temperature) || !message.pack(r.humidity) ||
+    !message.pack(r.location) || !message.pack(r.volts) ||
+    !message.pack(r.charging) || !message.pack_array((uint16_t)4))
+  {
+    return false;
+  }
+
+  for (i=0; i<4; i++)
+  {
+    if (!message.pack(r.samples[i]))
+    {
+      return false;
+    }
+  }
+
+  return message.pack(r.sequence);
+}
+
+static bool unpackByHand(BERGCloudMessage& message, Reading& r)
+{
+  uint16_t i, count;
+
+  if (!message.unpack(r.temperature) || !message.unpack(r.humidity) ||
+    !message.unpack(r.location, sizeof(r.location)) || !message.unpack(r.volts) ||
+    !message.unpack(r.charging) || !message.unpack_array(count) || (count != 4))
+  {
+    return false;
+  }
+
+  for (i=0; i<4; i++)
+  {
+    if (!message.unpack(r.samples[i]))
+    {
+      return false;
+    }
+  }
+
+  return message.unpack(r.sequence);
+}
+
+static bool sameReading(const Reading& a, const Reading& b)
+{
+  return (a.temperature == b.temperature) && (a.humidity == b.humidity) &&
+    (strcmp(a.location, b.location) == 0) && (a.volts == b.volts) &&
+    (a.charging == b.charging) && (memcmp(a.samples, b.samples, sizeof(a.samples)) == 0) &&
+    (a.sequence == b.sequence);
+}
+
+int main(void)
+{
+  Reading reading = { -1234, 55, "kitchen", 3.3f, true, { -1, 2, -3, 4 }, 123456 };
+  Reading unpacked;
+  BERGCloudMessage byHand;
+  BERGCloudMessage bySchema;
+  uint32_t i;
+  double start, packHandTime, packSchemaTime, unpackHandTime, unpackSchemaTime;
+
+  /* Both methods must produce identical bytes and recover every field */
+  if (!packByHand(byHand, reading) || !ReadingSchema::pack(bySchema, reading))
+  {
+    printf("Pack failed\n");
+    return 1;
+  }
+
+  if ((byHand.used() != bySchema.used()) ||
+    (memcmp(byHand.ptr(), bySchema.ptr(), byHand.used()) != 0))
+  {
+    printf("MISMATCH: %u bytes by hand, %u bytes by schema\n", byHand.used(), bySchema.used());
+    return 1;
+  }
+
+  memset(&unpacked, 0, sizeof(unpacked));
+  if (!ReadingSchema::unpack(bySchema, unpacked) || !sameReading(reading, unpacked))
+  {
+    printf("MISMATCH: schema unpack\n");
+    return 1;
+  }
+
+  printf("Reading: %u bytes packed, schema maxSize %u bytes\n",
+    bySchema.used(), (unsigned)ReadingSchema::maxSize);
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    byHand.clear();
+    reading.sequence = i;
+    packByHand(byHand, reading);
+  }
+  packHandTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    bySchema.clear();
+    reading.sequence = i;
+    ReadingSchema::pack(bySchema, reading);
+  }
+  packSchemaTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    byHand.restart();
+    unpackByHand(byHand, unpacked);
+  }
+  unpackHandTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    bySchema.restart();
+    ReadingSchema::unpack(bySchema, unpacked);
+  }
+  unpackSchemaTime = now() - start;
+
+  if (!sameReading(reading, unpacked))
+  {
+    printf("MISMATCH: timed unpack\n");
+    return 1;
+  }
+
+  printf("Time per reading, by hand -> schema:\n");
+  printf("  pack   %6.1f -> %6.1f ns\n",
+    (packHandTime * 1e9) / ITERATIONS, (packSchemaTime * 1e9) / ITERATIONS);
+  printf("  unpack %6.1f -> %6.1f ns\n",
+    (unpackHandTime * 1e9) / ITERATIONS, (unpackSchemaTime * 1e9) / ITERATIONS);
+
+  return 0;
+}
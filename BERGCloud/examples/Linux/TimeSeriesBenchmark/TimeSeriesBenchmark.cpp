@@ -0,0 +1,158 @@
+/*
+    TimeSeriesBenchmark - Encodes synthetic sensor traces with
+                          BERGCloudTimeSeriesEncoder, checks that they
+                          decode, and compares the size with packing
+                          each sample as an integer.
+
+    Build from this directory with:
+
+      g++ -O2 -DLINUX -DBERGCLOUD_PACK_UNPACK -DBUFFER_SIZE_BYTES=8192 \
+          -I../../.. TimeSeriesBenchmark.cpp ../../../BERGCloudTimeSeries.cpp \
+          ../../../BERGCloudMessageBase.cpp ../../../BERGCloudMessageBuffer.cpp \
+          ../../../BERGCloudByteSwap.cpp -o TimeSeriesBenchmark
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "BERGCloudLinux.h"
+#include "BERGCloudTimeSeries.h"
+
+/* Samples per trace, e.g. one a minute for a day */
+#define SAMPLES 1440
+
+/* Traces encoded per speed measurement */
+#define ITERATIONS 10000
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/* Temperature in hundredths of a degree: a slow daily cycle, */
+/* reported at a resolution of a tenth of a degree */
+static void temperature(int32_t *s)
+{
+  int32_t t = 1800;
+  int i;
+
+  for (i=0; i<SAMPLES; i++)
+  {
+    t += ((i % 1440) < 720) ? ((rand() % 8) == 0) : -((rand() % 8) == 0);
+    s[i] = t * 10;
+  }
+}
+
+/* Battery in millivolts: slow decline with an occasional step */
+static void battery(int32_t *s)
+{
+  int32_t mv = 4100;
+  int i;
+
+  for (i=0; i<SAMPLES; i++)
+  {
+    if ((rand() % 60) == 0)
+    {
+      mv -= 1 + (rand() % 3);
+    }
+    s[i] = mv;
+  }
+}
+
+/* Event counter: steady rate with bursts */
+static void counter(int32_t *s)
+{
+  int32_t n = 100000;
+  int i;
+
+  for (i=0; i<SAMPLES; i++)
+  {
+    n += ((rand() % 20) == 0) ? (rand() % 50) : 3;
+    s[i] = n;
+  }
+}
+
+/* Light in lux: zero at night, noisy during the day */
+static void light(int32_t *s)
+{
+  int i;
+
+  for (i=0; i<SAMPLES; i++)
+  {
+    s[i] = ((i % 1440) < 480) ? 0 : (800 + (rand() % 400));
+  }
+}
+
+static void benchmark(const char *name, void (*generate)(int32_t *))
+{
+  static int32_t samples[SAMPLES];
+  static int32_t decoded[SAMPLES];
+  static uint8_t encoded[SAMPLES * 6];
+  BERGCloudTimeSeriesEncoder encoder;
+  BERGCloudTimeSeriesDecoder decoder;
+  BERGCloudMessage message;
+  uint16_t size = 0;
+  uint16_t fixedSize, compactSize;
+  uint32_t i;
+  double start, encodeTime, decodeTime;
+
+  generate(samples);
+
+  /* Each sample packed as an int32_t, then in the smallest form */
+  message.pack_array(samples, SAMPLES);
+  fixedSize = message.used();
+
+  message.clear();
+  message.pack_compact();
+  message.pack_array(samples, SAMPLES);
+  compactSize = message.used();
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    encoder.begin(encoded, sizeof(encoded));
+    encoder.add(samples, SAMPLES);
+    size = encoder.end();
+  }
+  encodeTime = now() - start;
+
+  start = now();
+  for (i=0; i<ITERATIONS; i++)
+  {
+    decoder.begin(encoded, size);
+    decoder.next(decoded, SAMPLES);
+  }
+  decodeTime = now() - start;
+
+  if (memcmp(samples, decoded, sizeof(samples)) != 0)
+  {
+    printf("  %-12s MISMATCH\n", name);
+    return;
+  }
+
+  printf("  %-12s %5u bytes, %5.2f bytes per sample, %5.1fx smaller than int32, %4.1fx than compact;"
+    " encode %4.1f ns, decode %4.1f ns per sample\n",
+    name, size, (double)size / SAMPLES, (double)fixedSize / size, (double)compactSize / size,
+    (encodeTime * 1e9) / ((double)ITERATIONS * SAMPLES),
+    (decodeTime * 1e9) / ((double)ITERATIONS * SAMPLES));
+}
+
+int main(void)
+{
+  printf("%u-sample traces:\n", SAMPLES);
+
+  benchmark("temperature", temperature);
+  benchmark("battery", battery);
+  benchmark("counter", counter);
+  benchmark("light", light);
+
+  return 0;
+}
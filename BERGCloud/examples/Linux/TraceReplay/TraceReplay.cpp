@@ -0,0 +1,139 @@
+/*
+    TraceReplay - Records the SPI traffic of a short session with the
+                  simulated shield, then replays the trace repeatedly to
+                  measure how fast the host side of the protocol runs
+                  without any SPI or radio delays.
+
+    Build from this directory with:
+
+      g++ -O2 -DLINUX -DBERGCLOUD_PACK_UNPACK -DBERGCLOUD_NO_LOG -I../../.. \
+          TraceReplay.cpp ../../../BERGCloud[A-Z]*.cpp -o TraceReplay -lpthread
+
+    Logging is left out so that the library's messages aren't timed.
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "BERGCloudSimulator.h"
+#include "BERGCloudTrace.h"
+
+#define EVENTS   32
+#define COMMANDS 8
+
+static uint8_t trace[64 * 1024];
+
+static double now(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+/* The session is the same whether recording or replaying */
+static bool session(BERGCloudBase& shield)
+{
+  uint8_t data[32];
+  uint16_t dataSize;
+  char name[16];
+  uint8_t i;
+
+  if (!shield.connect(BERGCloudBase::nullKey, 1, true))
+  {
+    return false;
+  }
+
+  for (i=0; i<EVENTS; i++)
+  {
+    memset(data, i, sizeof(data));
+
+    if (!shield.sendEvent("reading", data, 1 + (i % sizeof(data))))
+    {
+      return false;
+    }
+  }
+
+  for (i=0; i<COMMANDS; i++)
+  {
+    if (!shield.pollForCommand(data, sizeof(data), dataSize, name, sizeof(name)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main(void)
+{
+  BERGCloudSimulator sim;
+  BERGCloudSimulatorConfig config = {
+    2,    /* byteTime_uS */
+    1,    /* timerReadTime_uS */
+    1000, /* responseLatency_uS */
+    1,    /* eventSendTime_mS */
+    1000, /* joinTime_mS */
+    COMMANDS,
+    BC_SIM_MAX_QUEUE_DEPTH
+  };
+  BERGCloudTraceRecorder recorder;
+  BERGCloudTraceReplay replay;
+  uint8_t command[4] = {0x93, 1, 2, 3};
+  uint32_t i, iterations, bytes;
+  double start, elapsed;
+
+  /* Record */
+  sim.begin(&config);
+
+  for (i=0; i<COMMANDS; i++)
+  {
+    sim.queueCommand("set", command, sizeof(command));
+  }
+
+  if (!recorder.begin(sim, trace, sizeof(trace)) || !session(recorder))
+  {
+    printf("Recording failed.\n");
+    return 1;
+  }
+
+  if (recorder.overflow)
+  {
+    printf("Trace buffer too small.\n");
+    return 1;
+  }
+
+  printf("Recorded %u bytes of trace.\n", recorder.traceSize);
+
+  /* Replay once to check the trace */
+  if (!replay.begin(trace, recorder.traceSize) || !session(replay) ||
+      !replay.finished() || (replay.mismatches != 0))
+  {
+    printf("Replay differs from recording (%u mismatches).\n", replay.mismatches);
+    return 1;
+  }
+
+  bytes = replay.bytesReplayed;
+  printf("Replay matches, %u bytes over SPI per session.\n", bytes);
+
+  /* Replay for about a second */
+  iterations = 0;
+  start = now();
+
+  do {
+    replay.begin(trace, recorder.traceSize);
+    session(replay);
+    iterations++;
+    elapsed = now() - start;
+  } while (elapsed < 1.0);
+
+  printf("%u sessions in %.2fs: %.1f us per session, %.1f MB/s\n",
+    iterations, elapsed, (elapsed * 1e6) / iterations,
+    ((double)iterations * bytes) / (elapsed * 1024 * 1024));
+
+  return 0;
+}
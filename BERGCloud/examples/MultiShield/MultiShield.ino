@@ -0,0 +1,90 @@
+/*
+    MultiShield - Drives two BERG Cloud Devshields on one SPI bus, sharing
+                  events between them so they are sent in parallel. For
+                  more info see http://bergcloud.com/
+
+    This example code is in the public domain.
+
+    https://github.com/bergcloud/devshield-arduino
+*/
+
+#include <BERGCloud.h>
+#include <BERGCloudRoundRobin.h>
+#include <SPI.h>
+
+#ifndef BERGCLOUD_ASYNC
+#error "Define BERGCLOUD_ASYNC in BERGCloudConfig.h to use BERGCloudRoundRobin"
+#endif
+
+// Each shield needs its own SPI slave select pin
+#define nSSEL_PIN_A 10
+#define nSSEL_PIN_B 9
+
+// The Project Key ties this code into a Project on developer.bergcloud.com
+const byte PROJECT_KEY[BC_KEY_SIZE_BYTES] = \
+    {0x8B,0x05,0xF7,0x25,0x10,0x54,0x0A,0xE4,0x7C,0x35,0xEE,0xE7,0x26,0xDC,0xD5,0xA8};
+
+// The version of your code
+#define VERSION 1
+
+// The library's BERGCloud object drives the first shield, add another
+// BERGCloudArduino object for each extra shield
+BERGCloudArduino BERGCloudB;
+
+// Events waiting to be sent by each shield
+BERGCloudEventOutbox outboxA(BERGCloud);
+BERGCloudEventOutbox outboxB(BERGCloudB);
+
+// Shares events between the shields
+BERGCloudRoundRobin shields;
+
+unsigned int counter;
+unsigned long lastSample;
+
+void setup()
+{
+  Serial.begin(115200);
+  Serial.println("--- Arduino reset ---");
+
+  // Set up both shields before talking to either, so neither is
+  // selected while the other is in use
+  BERGCloud.begin(&SPI, nSSEL_PIN_A);
+  BERGCloudB.begin(&SPI, nSSEL_PIN_B);
+
+  if (!BERGCloud.connect(PROJECT_KEY, VERSION)) {
+    Serial.println("Shield A: connect() returned false.");
+  }
+
+  if (!BERGCloudB.connect(PROJECT_KEY, VERSION)) {
+    Serial.println("Shield B: connect() returned false.");
+  }
+
+  shields.add(outboxA);
+  shields.add(outboxB);
+
+  counter = 0;
+  lastSample = millis();
+}
+
+void loop()
+{
+  BERGCloudMessage event;
+
+  // Take a reading ten times a second
+  if ((millis() - lastSample) >= 100) {
+    lastSample = millis();
+
+    event.pack(counter++);
+    event.pack(analogRead(A0));
+
+    // Queued on whichever shield has the fewest events waiting
+    if (!shields.queue("reading", event)) {
+      Serial.println("Both outboxes are full");
+    }
+  }
+
+  // Each shield sends in turn, one whole transaction at a time
+  if (!shields.service()) {
+    Serial.println("An event was dropped");
+  }
+}